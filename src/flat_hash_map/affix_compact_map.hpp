@@ -0,0 +1,242 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "faster_hashtable.hpp"
+#include "../string_hash/fixed_string.hpp"
+#include "../string_hash/key_region.hpp"
+#include "../string_hash/seeded_string_hash.hpp"
+
+namespace ddaof {
+
+/**
+ * The shape of a structured key: PrefixLength bytes shared by every key, MiddleLength variable bytes,
+ * SuffixLength shared bytes. Only the middle is stored, as a compact_key; the shared bytes live once
+ * in the equal functor, which is the per-table dictionary.
+ * A full key and its compact form hash the same, so lookups never have to build a compact_key.
+*/
+template<size_t PrefixLength, size_t MiddleLength, size_t SuffixLength>
+struct affix_layout {
+    static constexpr size_t key_length = PrefixLength + MiddleLength + SuffixLength;
+
+    using compact_key = fixed_string<MiddleLength>;
+    using region = key_region<PrefixLength, MiddleLength>;
+
+    struct hash {
+        typedef std::true_type is_avalanching;
+
+        size_t operator()(const std::string& key) const {
+            return typename region::hash()(key);
+        }
+
+        size_t operator()(const compact_key& key) const {
+            return seeded_string_hash::hash(key.data(), MiddleLength, 0);
+        }
+    };
+
+    class equal {
+    public:
+        equal() : _prefix(PrefixLength, '\0'), _suffix(SuffixLength, '\0') {}
+
+        equal(std::string prefix, std::string suffix)
+                : _prefix(std::move(prefix)), _suffix(std::move(suffix)) {
+            if (_prefix.size() != PrefixLength || _suffix.size() != SuffixLength) {
+                throw std::invalid_argument("Prefix or suffix passed to affix_compact_map has the wrong length.");
+            }
+        }
+
+        const std::string& prefix() const {
+            return _prefix;
+        }
+
+        const std::string& suffix() const {
+            return _suffix;
+        }
+
+        bool has_affix(const std::string& key) const {
+            return key.size() == key_length
+                   && memcmp(key.data(), _prefix.data(), PrefixLength) == 0
+                   && memcmp(key.data() + PrefixLength + MiddleLength, _suffix.data(), SuffixLength) == 0;
+        }
+
+        // the middle differs for almost every probed entry, so it is compared before the affix
+        bool operator()(const std::string& lhs, const compact_key& rhs) const {
+            return lhs.size() == key_length
+                   && region::window_equal(lhs.data() + PrefixLength, rhs.data())
+                   && has_affix(lhs);
+        }
+
+        bool operator()(const compact_key& lhs, const std::string& rhs) const {
+            return (*this)(rhs, lhs);
+        }
+
+        bool operator()(const compact_key& lhs, const compact_key& rhs) const {
+            return lhs == rhs;
+        }
+
+        bool operator()(const std::string& lhs, const std::string& rhs) const {
+            return lhs == rhs;
+        }
+
+        compact_key compact(const std::string& key) const {
+            if (!has_affix(key)) {
+                throw std::invalid_argument("Key passed to affix_compact_map does not have the table's prefix and suffix.");
+            }
+            return compact_key(key.data() + PrefixLength, MiddleLength);
+        }
+
+        std::string expand(const compact_key& key) const {
+            std::string result;
+            result.reserve(key_length);
+            result.append(_prefix).append(key.data(), MiddleLength).append(_suffix);
+            return result;
+        }
+
+    private:
+        std::string _prefix;
+        std::string _suffix;
+    };
+};
+
+// KeyOrValueHasher/KeyOrValueEquality that also take the compact key, which is what emplace hashes and compares
+template<typename Layout, typename value_type>
+struct affix_key_or_value_hasher : KeyOrValueHasher<std::string, value_type, typename Layout::hash> {
+    typedef KeyOrValueHasher<std::string, value_type, typename Layout::hash> base;
+    using base::base;
+    using base::operator();
+
+    size_t operator()(const typename Layout::compact_key& key) const {
+        return static_cast<const typename Layout::hash&>(*this)(key);
+    }
+};
+
+template<typename Layout, typename value_type>
+struct affix_key_or_value_equality : KeyOrValueEquality<std::string, value_type, typename Layout::equal> {
+    typedef KeyOrValueEquality<std::string, value_type, typename Layout::equal> base;
+    using base::base;
+    using base::operator();
+
+    bool operator()(const typename Layout::compact_key& lhs, const value_type& rhs) const {
+        return static_cast<const typename Layout::equal&>(*this)(lhs, rhs.first);
+    }
+};
+
+/**
+ * A map from structured string keys to V that stores only the MiddleLength variable bytes of each key.
+ * The defaults match the test data from src/random_string_generator.cpp: a 7-byte prefix, 49 random bytes
+ * and an 8-byte suffix, so an entry holds a 49-byte fixed_string instead of a 64-byte key (or a std::string
+ * header and a heap block), about 23% fewer key bytes and more entries per cache line.
+ *
+ *     ddaof::affix_compact_map<int> map("AAACPGC", "VVQTYPXX");
+ *     map[key] = 1;                          // throws std::invalid_argument if key has another prefix/suffix
+ *     auto found = map.find(key);            // lookups take the full key, a foreign key is just not found
+ *     std::string full = map.full_key(*found);
+ *
+ * Iteration yields std::pair<fixed_string<MiddleLength>, V>, the full key is only rebuilt by full_key().
+*/
+template<typename V, size_t PrefixLength = 7, size_t MiddleLength = 49, size_t SuffixLength = 8,
+         typename A = std::allocator<std::pair<fixed_string<MiddleLength>, V>>>
+class affix_compact_map
+        : public ddaof::faster_hashtable <
+            std::pair<fixed_string<MiddleLength>, V>,
+            std::string,
+            typename affix_layout<PrefixLength, MiddleLength, SuffixLength>::hash,
+            affix_key_or_value_hasher<affix_layout<PrefixLength, MiddleLength, SuffixLength>, std::pair<fixed_string<MiddleLength>, V>>,
+            typename affix_layout<PrefixLength, MiddleLength, SuffixLength>::equal,
+            affix_key_or_value_equality<affix_layout<PrefixLength, MiddleLength, SuffixLength>, std::pair<fixed_string<MiddleLength>, V>>,
+            A,
+            typename std::allocator_traits<A>::template rebind_alloc<ddaof::faster_table_entry<std::pair<fixed_string<MiddleLength>, V>>>> {
+    using Layout = affix_layout<PrefixLength, MiddleLength, SuffixLength>;
+    using Table = ddaof::faster_hashtable
+    <
+        std::pair<fixed_string<MiddleLength>, V>,
+        std::string,
+        typename Layout::hash,
+        affix_key_or_value_hasher<Layout, std::pair<fixed_string<MiddleLength>, V>>,
+        typename Layout::equal,
+        affix_key_or_value_equality<Layout, std::pair<fixed_string<MiddleLength>, V>>,
+        A,
+        typename std::allocator_traits<A>::template rebind_alloc<ddaof::faster_table_entry<std::pair<fixed_string<MiddleLength>, V>>>
+    >;
+public:
+    using key_type = std::string;
+    using compact_key_type = typename Layout::compact_key;
+    using mapped_type = V;
+
+    static constexpr size_t key_length = Layout::key_length;
+
+    affix_compact_map(std::string prefix, std::string suffix, size_t bucket_count = 0, const A& alloc = A())
+            : Table(bucket_count, typename Layout::hash(),
+                    typename Layout::equal(std::move(prefix), std::move(suffix)), alloc) {}
+
+    const std::string& prefix() const {
+        return this->key_eq().prefix();
+    }
+
+    const std::string& suffix() const {
+        return this->key_eq().suffix();
+    }
+
+    // throws std::invalid_argument when the key does not have the table's prefix and suffix
+    compact_key_type compact(const std::string& key) const {
+        return this->key_eq().compact(key);
+    }
+
+    std::string full_key(const compact_key_type& key) const {
+        return this->key_eq().expand(key);
+    }
+
+    std::string full_key(const typename Table::value_type& value) const {
+        return this->key_eq().expand(value.first);
+    }
+
+    template<typename... Args>
+    std::pair<typename Table::iterator, bool> emplace(const std::string& key, Args&&... args) {
+        return Table::emplace(compact(key), std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    std::pair<typename Table::iterator, bool> emplace(const compact_key_type& key, Args&&... args) {
+        return Table::emplace(key, std::forward<Args>(args)...);
+    }
+
+    inline V& operator[](const std::string& key) {
+        return emplace(key, convertible_to_value()).first->second;
+    }
+
+    V& at(const std::string& key) {
+        auto found = this->find(key);
+        if (found == this->end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+    const V& at(const std::string& key) const {
+        auto found = this->find(key);
+        if (found == this->end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+    template<typename M>
+    std::pair<typename Table::iterator, bool> insert_or_assign(const std::string& key, M&& m) {
+        auto emplace_result = emplace(key, std::forward<M>(m));
+        if (!emplace_result.second)
+            emplace_result.first->second = std::forward<M>(m);
+        return emplace_result;
+    }
+
+private:
+    struct convertible_to_value {
+        operator V() const {
+            return V();
+        }
+    };
+};
+
+} // end namespace ddaof
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "faster_hashtable.hpp"
+#include "../string_hash/hashed_view.hpp"
+
+namespace ddaof {
+
+// where a key's bytes sit in the arena, 40 bits of offset and 24 bits of length, plus the key's full hash
+class arena_key {
+public:
+    static constexpr size_t max_length = (size_t(1) << 24) - 1;
+    static constexpr uint64_t max_offset = (uint64_t(1) << 40) - 1;
+
+    arena_key(uint64_t offset, size_t length, uint64_t hash)
+            : _location(offset << 24 | length), _hash(hash) {}
+
+    uint64_t offset() const {
+        return _location >> 24;
+    }
+
+    size_t length() const {
+        return static_cast<size_t>(_location & max_length);
+    }
+
+    uint64_t hash() const {
+        return _hash;
+    }
+
+    void move_to(uint64_t offset) {
+        _location = offset << 24 | length();
+    }
+
+private:
+    uint64_t _location;
+    uint64_t _hash;
+};
+
+struct arena_key_hash {
+    typedef std::true_type is_avalanching;
+
+    size_t operator()(const hashed_view& key) const {
+        return key.hash;
+    }
+
+    size_t operator()(const arena_key& key) const {
+        return key.hash();
+    }
+};
+
+/**
+ * The comparator of an arena_string_map, which also owns the map's key bytes: the table keeps its
+ * functors next to its entries, so the arena moves and swaps together with the entries that point into it.
+ * The stored hash is compared first, the arena is only read when the hashes match.
+*/
+class key_arena {
+public:
+    bool operator()(const hashed_view& lhs, const arena_key& rhs) const {
+        return lhs.hash == rhs.hash() && lhs.str.size() == rhs.length() && bytes_equal(lhs.str.data(), rhs);
+    }
+
+    bool operator()(const arena_key& lhs, const hashed_view& rhs) const {
+        return (*this)(rhs, lhs);
+    }
+
+    bool operator()(const arena_key& lhs, const arena_key& rhs) const {
+        return lhs.hash() == rhs.hash() && lhs.length() == rhs.length()
+               && (lhs.offset() == rhs.offset() || bytes_equal(data() + lhs.offset(), rhs));
+    }
+
+    bool operator()(const hashed_view& lhs, const hashed_view& rhs) const {
+        return lhs == rhs;
+    }
+
+    std::string_view view(const arena_key& key) const {
+        return std::string_view(data() + key.offset(), key.length());
+    }
+
+    arena_key append(const hashed_view& key) {
+        if (key.str.size() > arena_key::max_length || _bytes.size() > arena_key::max_offset) {
+            throw std::length_error("Key passed to arena_string_map does not fit in its arena.");
+        }
+        uint64_t offset = _bytes.size();
+        _bytes.insert(_bytes.end(), key.str.begin(), key.str.end());
+        return arena_key(offset, key.str.size(), key.hash);
+    }
+
+    // takes back the bytes of the last append() when the insert that needed them failed
+    void truncate(const arena_key& key) {
+        _bytes.resize(key.offset());
+    }
+
+    void release(const arena_key& key) {
+        _dead_bytes += key.length();
+    }
+
+    size_t size() const {
+        return _bytes.size();
+    }
+
+    size_t capacity() const {
+        return _bytes.capacity();
+    }
+
+    size_t dead_bytes() const {
+        return _dead_bytes;
+    }
+
+    void clear() {
+        std::vector<char>().swap(_bytes);
+        _dead_bytes = 0;
+    }
+
+    // copies the live keys into a fresh arena in slot order and points them at their new offsets
+    template<typename It>
+    void compact(It begin, It end, size_t live_bytes) {
+        std::vector<char> compacted;
+        compacted.reserve(live_bytes);
+        for (; begin != end; ++begin) {
+            arena_key& key = begin->first;
+            const char* bytes = data() + key.offset();
+            key.move_to(compacted.size());
+            compacted.insert(compacted.end(), bytes, bytes + key.length());
+        }
+        _bytes.swap(compacted);
+        _dead_bytes = 0;
+    }
+
+private:
+    std::vector<char> _bytes;
+    size_t _dead_bytes = 0;
+
+    const char* data() const {
+        return _bytes.data();
+    }
+
+    bool bytes_equal(const char* lhs, const arena_key& rhs) const {
+        return rhs.length() == 0 || memcmp(lhs, data() + rhs.offset(), rhs.length()) == 0;
+    }
+};
+
+// KeyOrValueHasher/KeyOrValueEquality that also take the arena_key, which is what emplace hashes and compares
+template<typename value_type>
+struct arena_key_or_value_hasher : KeyOrValueHasher<hashed_view, value_type, arena_key_hash> {
+    typedef KeyOrValueHasher<hashed_view, value_type, arena_key_hash> base;
+    using base::base;
+    using base::operator();
+
+    size_t operator()(const arena_key& key) const {
+        return key.hash();
+    }
+};
+
+template<typename value_type>
+struct arena_key_or_value_equality : KeyOrValueEquality<hashed_view, value_type, key_arena> {
+    typedef KeyOrValueEquality<hashed_view, value_type, key_arena> base;
+    using base::base;
+    using base::operator();
+
+    bool operator()(const arena_key& lhs, const value_type& rhs) const {
+        return static_cast<const key_arena&>(*this)(lhs, rhs.first);
+    }
+};
+
+/**
+ * A string-keyed map whose key bytes live in one append-only arena owned by the table.
+ * A slot holds a 16-byte arena_key (offset, length and the full hash) instead of a 32-byte std::string
+ * with its own heap block, so a probe walks dense slots and reads one arena line only when the stored
+ * hash matches, and destroying the map frees one buffer instead of running a destructor per key.
+ *
+ *     ddaof::arena_string_map<int> map;
+ *     map["AAACPGC..."] = 1;
+ *     for (auto& entry : map) use(map.key(entry), entry.second);
+ *
+ * Erased keys leave their bytes behind. Whenever the table grows and at least half of the arena is dead,
+ * the live keys are copied into a fresh arena; compact() does the same on demand.
+ * key() views point into the arena, so inserting a new key invalidates them like it invalidates iterators;
+ * finding or assigning to a key that is already there leaves the arena alone.
+*/
+template<typename V, typename A = std::allocator<std::pair<arena_key, V>>>
+class arena_string_map
+        : public ddaof::faster_hashtable <
+            std::pair<arena_key, V>,
+            hashed_view,
+            arena_key_hash,
+            arena_key_or_value_hasher<std::pair<arena_key, V>>,
+            key_arena,
+            arena_key_or_value_equality<std::pair<arena_key, V>>,
+            A,
+            typename std::allocator_traits<A>::template rebind_alloc<ddaof::faster_table_entry<std::pair<arena_key, V>>>> {
+    using Table = ddaof::faster_hashtable
+    <
+        std::pair<arena_key, V>,
+        hashed_view,
+        arena_key_hash,
+        arena_key_or_value_hasher<std::pair<arena_key, V>>,
+        key_arena,
+        arena_key_or_value_equality<std::pair<arena_key, V>>,
+        A,
+        typename std::allocator_traits<A>::template rebind_alloc<ddaof::faster_table_entry<std::pair<arena_key, V>>>
+    >;
+public:
+    using key_type = std::string_view;
+    using mapped_type = V;
+
+    arena_string_map() {}
+
+    explicit arena_string_map(size_t bucket_count, const A& alloc = A())
+            : Table(bucket_count, arena_key_hash(), key_arena(), alloc) {}
+
+    arena_string_map(const arena_string_map& other) = default;
+    arena_string_map& operator=(const arena_string_map& other) = default;
+
+    arena_string_map(arena_string_map&& other) noexcept
+            : Table(std::move(other)) {}
+
+    // the table swaps its entries but moves its comparator, so other's entries would point at a moved-from arena
+    arena_string_map& operator=(arena_string_map&& other) noexcept {
+        Table::operator=(std::move(other));
+        other.clear();
+        return *this;
+    }
+
+    std::string_view key(const typename Table::value_type& value) const {
+        return this->key_eq().view(value.first);
+    }
+
+    typename Table::iterator find(std::string_view key) {
+        return Table::find(hashed_view::of(key));
+    }
+
+    typename Table::const_iterator find(std::string_view key) const {
+        return Table::find(hashed_view::of(key));
+    }
+
+    size_t count(std::string_view key) const {
+        return Table::count(hashed_view::of(key));
+    }
+
+    // the key bytes are only appended to the arena once the key is known to be new
+    template<typename... Args>
+    std::pair<typename Table::iterator, bool> emplace(std::string_view key, Args&&... args) {
+        hashed_view hashed = hashed_view::of(key);
+        auto found = Table::find(hashed);
+        if (found != this->end()) {
+            return std::make_pair(found, false);
+        }
+
+        key_arena& arena = this->mutable_key_eq();
+        arena_key appended = arena.append(hashed);
+        size_t old_bucket_count = this->bucket_count();
+        std::pair<typename Table::iterator, bool> result;
+        try {
+            result = Table::emplace(appended, std::forward<Args>(args)...);
+        } catch (...) {
+            arena.truncate(appended);
+            throw;
+        }
+        if (this->bucket_count() != old_bucket_count && arena.dead_bytes() * 2 >= arena.size()
+                && arena.dead_bytes() != 0) {
+            compact();
+            result.first = Table::find(hashed);
+        }
+        return result;
+    }
+
+    inline V& operator[](std::string_view key) {
+        return emplace(key, convertible_to_value()).first->second;
+    }
+
+    V& at(std::string_view key) {
+        auto found = find(key);
+        if (found == this->end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+    const V& at(std::string_view key) const {
+        auto found = find(key);
+        if (found == this->end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+    template<typename M>
+    std::pair<typename Table::iterator, bool> insert_or_assign(std::string_view key, M&& m) {
+        auto emplace_result = emplace(key, std::forward<M>(m));
+        if (!emplace_result.second)
+            emplace_result.first->second = std::forward<M>(m);
+        return emplace_result;
+    }
+
+    typename Table::iterator erase(typename Table::const_iterator to_erase) {
+        this->mutable_key_eq().release(to_erase->first);
+        return Table::erase(to_erase);
+    }
+
+    size_t erase(std::string_view key) {
+        auto found = find(key);
+        if (found == this->end()) {
+            return 0;
+        }
+        erase(found);
+        return 1;
+    }
+
+    void clear() {
+        Table::clear();
+        this->mutable_key_eq().clear();
+    }
+
+    void compact() {
+        key_arena& arena = this->mutable_key_eq();
+        arena.compact(this->begin(), this->end(), arena.size() - arena.dead_bytes());
+    }
+
+    // bytes in the arena that belong to erased keys
+    size_t dead_key_bytes() const {
+        return this->key_eq().dead_bytes();
+    }
+
+    size_t memory_usage() const {
+        return Table::memory_usage() + this->key_eq().capacity();
+    }
+
+    size_t deep_memory_usage() const {
+        return Table::deep_memory_usage() + this->key_eq().capacity();
+    }
+
+private:
+    struct convertible_to_value {
+        operator V() const {
+            return V();
+        }
+    };
+};
+
+} // end namespace ddaof
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+#include "faster_hashtable.hpp"
+
+namespace ddaof {
+
+// 64-bit FNV-1a, usable in constant expressions
+struct fnv1a_hash {
+    static constexpr uint64_t offset_basis = 14695981039346656037ull;
+    static constexpr uint64_t prime = 1099511628211ull;
+
+    constexpr size_t operator()(std::string_view str) const {
+        uint64_t hash = offset_basis;
+        for (char c : str) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= prime;
+        }
+        return hash;
+    }
+
+    constexpr size_t operator()(uint64_t value) const {
+        uint64_t hash = offset_basis;
+        for (int i = 0; i < 8; ++i) {
+            hash ^= (value >> (8 * i)) & 0xff;
+            hash *= prime;
+        }
+        return hash;
+    }
+};
+
+/**
+ * An immutable map whose keys are known at compile time.
+ * The constructor runs a hash-and-displace search in a constant expression: keys are grouped into
+ * buckets by their hash, and every bucket gets a seed that sends all of its keys to free slots.
+ * A lookup is one hash, one seed load, one index computation and one key compare.
+ * H and E are used through KeyOrValueHasher / KeyOrValueEquality, the same adapters flat_hash_map
+ * uses, so any functor works as long as its call operator is constexpr.
+ *
+ *     static constexpr auto commands = ddaof::make_constexpr_map<std::string_view, int>({
+ *         { "get", 1 }, { "set", 2 }, { "del", 3 }
+ *     });
+ *     const int* id = commands.find(name);
+*/
+template<typename K, typename V, size_t N, typename H = fnv1a_hash, typename E = std::equal_to<K>>
+class constexpr_map : private ddaof::KeyOrValueHasher<K, std::pair<K, V>, H>,
+                      private ddaof::KeyOrValueEquality<K, std::pair<K, V>, E> {
+    using Hasher = ddaof::KeyOrValueHasher<K, std::pair<K, V>, H>;
+    using Equal = ddaof::KeyOrValueEquality<K, std::pair<K, V>, E>;
+
+    static constexpr size_t constexpr_next_power_of_two(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static_assert(N > 0, "constexpr_map needs at least one key");
+
+    static constexpr size_t _num_buckets = constexpr_next_power_of_two(N);
+    // at most half full, so every bucket finds its seed after a few tries
+    static constexpr size_t _num_slots = 2 * _num_buckets;
+    static constexpr uint32_t _max_seed = 1u << 16;
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using size_type = size_t;
+
+    using hasher = H;
+    using key_equal = E;
+
+    constexpr constexpr_map(const value_type (&items)[N], const H& hash = H(), const E& equal = E())
+            : Hasher(hash), Equal(equal) {
+        std::array<size_t, N> hashes{};
+        std::array<size_t, _num_buckets> bucket_sizes{};
+        size_t max_bucket_size = 0;
+        for (size_t i = 0; i < N; ++i) {
+            hashes[i] = hash_object(items[i].first);
+            for (size_t j = 0; j < i; ++j) {
+                if (hashes[j] == hashes[i]) {
+                    throw std::invalid_argument("constexpr_map keys must be unique and must not share a hash value.");
+                }
+            }
+            size_t bucket_size = ++bucket_sizes[hashes[i] & (_num_buckets - 1)];
+            max_bucket_size = bucket_size > max_bucket_size ? bucket_size : max_bucket_size;
+        }
+
+        // the biggest buckets are the hardest to place, so they go first
+        std::array<bool, _num_slots> taken{};
+        for (size_t bucket_size = max_bucket_size; bucket_size > 0; --bucket_size) {
+            for (size_t bucket = 0; bucket < _num_buckets; ++bucket) {
+                if (bucket_sizes[bucket] == bucket_size) {
+                    place_bucket(items, hashes, bucket, taken);
+                }
+            }
+        }
+
+        // an empty slot holds the first key: that key always lands in its own slot,
+        // and no other key compares equal to it, so a lookup never needs an occupancy check
+        for (size_t slot = 0; slot < _num_slots; ++slot) {
+            if (!taken[slot]) {
+                _keys[slot] = items[0].first;
+            }
+        }
+    }
+
+    constexpr const V* find(const K& key) const {
+        size_t slot = slot_for_hash(hash_object(key));
+        return compares_equal(key, _keys[slot]) ? &_values[slot] : nullptr;
+    }
+
+    constexpr size_t count(const K& key) const {
+        return find(key) ? 1 : 0;
+    }
+
+    constexpr const V& at(const K& key) const {
+        const V* found = find(key);
+        if (!found)
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return *found;
+    }
+
+    static constexpr size_t size() {
+        return N;
+    }
+
+    static constexpr bool empty() {
+        return false;
+    }
+
+    static constexpr size_t bucket_count() {
+        return _num_slots;
+    }
+
+private:
+    std::array<K, _num_slots> _keys{};
+    std::array<V, _num_slots> _values{};
+    std::array<uint32_t, _num_buckets> _seeds{};
+
+    constexpr size_t slot_for_hash(size_t hash) const {
+        // fmix64 so that the seed changes every bit of the slot index
+        return ddaof::fmix64(hash ^ _seeds[hash & (_num_buckets - 1)]) & (_num_slots - 1);
+    }
+
+    constexpr void place_bucket(const value_type (&items)[N], const std::array<size_t, N>& hashes,
+                                size_t bucket, std::array<bool, _num_slots>& taken) {
+        for (uint32_t seed = 0; seed < _max_seed; ++seed) {
+            std::array<size_t, N> slots{};
+            size_t num_placed = 0;
+            bool fits = true;
+            for (size_t i = 0; i < N && fits; ++i) {
+                if ((hashes[i] & (_num_buckets - 1)) != bucket) {
+                    continue;
+                }
+                size_t slot = ddaof::fmix64(hashes[i] ^ seed) & (_num_slots - 1);
+                fits = !taken[slot];
+                for (size_t j = 0; j < num_placed && fits; ++j) {
+                    fits = slots[j] != slot;
+                }
+                slots[num_placed++] = slot;
+            }
+            if (!fits) {
+                continue;
+            }
+
+            _seeds[bucket] = seed;
+            for (size_t i = 0, placed = 0; i < N; ++i) {
+                if ((hashes[i] & (_num_buckets - 1)) == bucket) {
+                    size_t slot = slots[placed++];
+                    taken[slot] = true;
+                    _keys[slot] = items[i].first;
+                    _values[slot] = items[i].second;
+                }
+            }
+            return;
+        }
+        throw std::invalid_argument("constexpr_map could not find a collision-free seed.");
+    }
+
+    template<typename U>
+    constexpr size_t hash_object(const U& key) const {
+        return static_cast<const Hasher&>(*this)(key);
+    }
+
+    template<typename L, typename R>
+    constexpr bool compares_equal(const L& lhs, const R& rhs) const {
+        return static_cast<const Equal&>(*this)(lhs, rhs);
+    }
+};
+
+template<typename K, typename V, typename H = fnv1a_hash, typename E = std::equal_to<K>, size_t N>
+constexpr constexpr_map<K, V, N, H, E> make_constexpr_map(const std::pair<K, V> (&items)[N]) {
+    return constexpr_map<K, V, N, H, E>(items);
+}
+
+} // end namespace ddaof
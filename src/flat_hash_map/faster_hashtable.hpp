@@ -21,14 +21,25 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <initializer_list>
 #include <math.h>
 #include <memory>
+#include <ostream>
 #include <stdexcept>
 #include <stdint.h>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#ifdef DDAOF_OPERATION_COUNTERS
+#include <atomic>
+#endif
+
+#include "owned_heap_bytes.hpp"
 
 #ifdef _MSC_VER
+#include <intrin.h>
 #define DDAOF_NOINLINE(...) __declspec(noinline) __VA_ARGS__
 #else
 #define DDAOF_NOINLINE(...) __VA_ARGS__ __attribute__((noinline))
@@ -52,7 +63,7 @@ struct prime_number_hash_policy;
 template<typename Result, typename Functor> // AmnesiaHzd: its a function wrapper
 struct functor_storage : Functor {
     functor_storage() = default;
-    functor_storage(const Functor& functor)
+    constexpr functor_storage(const Functor& functor)
             : Functor(functor) {}
 
     template<typename... Args>
@@ -61,7 +72,7 @@ struct functor_storage : Functor {
     }
 
     template<typename... Args>
-    Result operator()(Args&& ...args) const {
+    constexpr Result operator()(Args&& ...args) const {
         return static_cast<const Functor&>(*this)(std::forward<Args>(args)...);
     }
 };
@@ -93,14 +104,14 @@ struct KeyOrValueHasher : functor_storage<size_t, hasher> { // Encapsulate hash
     // why cant use hasher_storage = functor_storage<size_t, hasher>
     
     KeyOrValueHasher() = default;
-    KeyOrValueHasher(const hasher& hash)
+    constexpr KeyOrValueHasher(const hasher& hash)
             : hasher_storage(hash) {}
 
     size_t operator()(const key_type& key) {
         return static_cast<hasher_storage&>(*this)(key);
     }
 
-    size_t operator()(const key_type& key) const { // const 是否应该是const *this
+    constexpr size_t operator()(const key_type& key) const { // const 是否应该是const *this
         return static_cast<const hasher_storage&>(*this)(key);
     }
 
@@ -108,7 +119,7 @@ struct KeyOrValueHasher : functor_storage<size_t, hasher> { // Encapsulate hash
         return static_cast<hasher_storage&>(*this)(value.first);
     }
 
-    size_t operator()(const value_type& value) const {
+    constexpr size_t operator()(const value_type& value) const {
         return static_cast<const hasher_storage&>(*this)(value.first);
     }
 
@@ -118,7 +129,7 @@ struct KeyOrValueHasher : functor_storage<size_t, hasher> { // Encapsulate hash
     }
 
     template<typename First, typename Second>
-    size_t operator()(const std::pair<First, Second>& value) const {
+    constexpr size_t operator()(const std::pair<First, Second>& value) const {
         return static_cast<const hasher_storage&>(*this)(value.first);
     }
 };
@@ -127,13 +138,29 @@ template<typename key_type, typename value_type, typename key_equal>
 struct KeyOrValueEquality : functor_storage<bool, key_equal> {
     typedef functor_storage<bool, key_equal> equality_storage;
     KeyOrValueEquality() = default;
-    KeyOrValueEquality(const key_equal& equality)
+    constexpr KeyOrValueEquality(const key_equal& equality)
             : equality_storage(equality) {}
 
     bool operator()(const key_type& lhs, const key_type& rhs) {
         return static_cast<equality_storage&>(*this)(lhs, rhs);
     }
 
+    constexpr bool operator()(const key_type& lhs, const key_type& rhs) const {
+        return static_cast<const equality_storage&>(*this)(lhs, rhs);
+    }
+
+    constexpr bool operator()(const key_type& lhs, const value_type& rhs) const {
+        return static_cast<const equality_storage&>(*this)(lhs, rhs.first);
+    }
+
+    constexpr bool operator()(const value_type& lhs, const key_type& rhs) const {
+        return static_cast<const equality_storage&>(*this)(lhs.first, rhs);
+    }
+
+    constexpr bool operator()(const value_type& lhs, const value_type& rhs) const {
+        return static_cast<const equality_storage&>(*this)(lhs.first, rhs.first);
+    }
+
     bool operator()(const key_type& lhs, const value_type& rhs) {
         return static_cast<equality_storage&>(*this)(lhs, rhs.first);
     }
@@ -266,26 +293,312 @@ inline size_t next_power_of_two(size_t i) {
     return i;
 }
 
+// The high 64 bits of the 128-bit product
+inline uint64_t mul_high(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__)
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(lhs) * rhs) >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return __umulh(lhs, rhs);
+#else
+    uint64_t lhs_lo = lhs & 0xffffffff, lhs_hi = lhs >> 32;
+    uint64_t rhs_lo = rhs & 0xffffffff, rhs_hi = rhs >> 32;
+    uint64_t lo_lo = lhs_lo * rhs_lo;
+    uint64_t hi_lo = lhs_hi * rhs_lo;
+    uint64_t lo_hi = lhs_lo * rhs_hi;
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+    return lhs_hi * rhs_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+}
+
+// murmur3 finalizer, every input bit affects every output bit
+constexpr uint64_t fmix64(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
 template<typename...> 
 using void_t = void;
 
 template<typename T, typename = void>
-struct HashPolicySelector {
+struct DeclaredHashPolicy {
     typedef fibonacci_hash_policy type;
 };
 
 template<typename T>
-struct HashPolicySelector<T, void_t<typename T::hash_policy>> {
+struct DeclaredHashPolicy<T, void_t<typename T::hash_policy>> {
     typedef typename T::hash_policy type;
 };
 
+// A hasher that already spreads every input bit over the whole result declares
+// `typedef std::true_type is_avalanching;` and never gets an extra mixing step.
+template<typename T, typename = void>
+struct hash_is_avalanching : std::false_type {};
+
+template<typename T>
+struct hash_is_avalanching<T, void_t<typename T::is_avalanching>> : std::true_type {};
+
+// A hasher with a reseed() member lets the table answer probe chains that overflow at a low load
+// factor, the signature of hash flooding, by rehashing once with a fresh seed instead of growing
+template<typename T, typename = void>
+struct hash_is_reseedable : std::false_type {};
+
+template<typename T>
+struct hash_is_reseedable<T, void_t<decltype(std::declval<T&>().reseed())>> : std::true_type {};
+
+// A hasher that declares `typedef std::true_type remember_last_hit;` turns on last_hit_cache,
+// for streams where the same key comes several times in a row
+template<typename T, typename = void>
+struct hash_remembers_last_hit : std::false_type {};
+
+template<typename T>
+struct hash_remembers_last_hit<T, void_t<typename T::remember_last_hit>> : T::remember_last_hit {};
+
+// Hashers known to keep the key bits as they are, std::hash of integers, enums and pointers
+// is the identity in libstdc++. Specialize this for your own weak hashers.
+template<typename T>
+struct hash_is_weak : std::false_type {};
+
+template<typename T>
+struct hash_is_weak<std::hash<T>>
+        : std::integral_constant<bool, std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value> {};
+
+// also catches `struct my_hash : std::hash<uint64_t> { typedef power_of_two_hash_policy hash_policy; };`
+template<typename T, typename Key>
+struct inherits_weak_hash
+        : std::integral_constant<bool, std::is_base_of<std::hash<Key>, T>::value && hash_is_weak<std::hash<Key>>::value> {};
+
+template<typename T>
+struct inherits_weak_hash<T, void> : std::false_type {};
+
+template<typename T, typename Key = void>
+struct hash_needs_mixing
+        : std::integral_constant<bool, !hash_is_avalanching<T>::value
+                                       && (hash_is_weak<T>::value || inherits_weak_hash<T, Key>::value)> {};
+
+// Policies that index with the low bits of the hash as they are,
+// fibonacci and fastrange multiply first and prime takes a modulo, so they are robust on their own
+template<typename Policy>
+struct hash_policy_needs_mixed_input : std::false_type {};
+
+template<>
+struct hash_policy_needs_mixed_input<power_of_two_hash_policy> : std::true_type {};
+
+// Runs the hash through fmix64 before handing it to Policy
+template<typename Policy>
+struct premixed_hash_policy : Policy {
+    size_t index_for_hash(size_t hash, size_t num_slots_minus_one) const {
+        return Policy::index_for_hash(ddaof::fmix64(hash), num_slots_minus_one);
+    }
+};
+
+// The policy declared by the hasher (fibonacci by default),
+// wrapped in premixed_hash_policy when a known-weak hasher meets a policy that needs good low bits
+template<typename T, typename Key = void>
+struct HashPolicySelector {
+    typedef typename DeclaredHashPolicy<T>::type declared_type;
+    typedef typename std::conditional<hash_needs_mixing<T, Key>::value && hash_policy_needs_mixed_input<declared_type>::value,
+                                      premixed_hash_policy<declared_type>,
+                                      declared_type>::type type;
+};
+
+enum class table_counter : uint8_t {
+    find_hit,
+    find_miss,
+    probe_step,
+    compare,
+    robin_hood_swap,
+    backward_shift_move,
+    grow_for_load,
+    grow_for_max_lookups,
+    bytes_allocated,
+    stash_insert,
+    reseed,
+    last_hit, // find or emplace answered by last_hit_cache, no hashing and no probing
+    num_counters
+};
+
+// What faster_hashtable::counters() reads back, all zero unless DDAOF_OPERATION_COUNTERS is defined
+struct operation_counts {
+    uint64_t values[static_cast<size_t>(table_counter::num_counters)] = {};
+
+    uint64_t operator[](table_counter counter) const {
+        return values[static_cast<size_t>(counter)];
+    }
+};
+
+// The default: an empty base that every call compiles away from
+struct null_operation_counters {
+    void add_count(table_counter, uint64_t = 1) const {}
+
+    operation_counts read_counts() const {
+        return {};
+    }
+};
+
+#ifdef DDAOF_OPERATION_COUNTERS
+/**
+ * Per-table counters, sharded by thread so that concurrent finds on a shared table
+ * do not fight over one cache line. Every thread picks a shard once, adds with relaxed atomics,
+ * and read_counts() sums the shards. The shards are allocated on the first add,
+ * and copies and moves start from zero: they count what is done through that object.
+*/
+class sharded_operation_counters {
+    static constexpr size_t num_shards = 16;
+
+    struct alignas(64) shard {
+        std::atomic<uint64_t> values[static_cast<size_t>(table_counter::num_counters)] = {};
+    };
+
+public:
+    sharded_operation_counters() = default;
+    sharded_operation_counters(const sharded_operation_counters&) {}
+    sharded_operation_counters& operator=(const sharded_operation_counters&) {
+        return *this;
+    }
+
+    ~sharded_operation_counters() {
+        delete[] _shards.load(std::memory_order_acquire);
+    }
+
+    void add_count(table_counter counter, uint64_t amount = 1) const {
+        shard* shards = _shards.load(std::memory_order_acquire);
+        if (!shards) {
+            shards = allocate_shards();
+        }
+        shards[thread_shard()].values[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    operation_counts read_counts() const {
+        operation_counts result;
+        shard* shards = _shards.load(std::memory_order_acquire);
+        for (size_t i = 0; shards && i < num_shards; ++i) {
+            for (size_t counter = 0; counter < static_cast<size_t>(table_counter::num_counters); ++counter) {
+                result.values[counter] += shards[i].values[counter].load(std::memory_order_relaxed);
+            }
+        }
+        return result;
+    }
+
+private:
+    mutable std::atomic<shard*> _shards{ nullptr };
+
+    static size_t thread_shard() {
+        static std::atomic<size_t> next_shard{ 0 };
+        static thread_local size_t index = next_shard.fetch_add(1, std::memory_order_relaxed) % num_shards;
+        return index;
+    }
+
+    DDAOF_NOINLINE(shard*) allocate_shards() const {
+        shard* shards = new shard[num_shards];
+        shard* expected = nullptr;
+        if (!_shards.compare_exchange_strong(expected, shards, std::memory_order_acq_rel)) {
+            delete[] shards;
+            return expected;
+        }
+        return shards;
+    }
+};
+
+using operation_counters = sharded_operation_counters;
+#else
+using operation_counters = null_operation_counters;
+#endif
+
+/**
+ * The entry that the last find or emplace landed on. Before hashing, a lookup compares its key with
+ * that entry, so a run of the same key costs one compare per operation instead of a hash and a probe.
+ * A lookup for another key pays the one extra compare. Robin hood inserts may move another element
+ * into the remembered slot, which the compare catches. Rehash, erase, clear and swap forget the entry,
+ * because they can leave the slot empty or point it into another table.
+ * Off by default, an empty base whose last_hit() is always null; see hash_remembers_last_hit.
+*/
+template<typename EntryPointer, bool Enabled>
+struct last_hit_cache {
+    EntryPointer last_hit() const {
+        return nullptr;
+    }
+
+    void remember_hit(EntryPointer) {}
+    void forget_hit() {}
+};
+
+template<typename EntryPointer>
+struct last_hit_cache<EntryPointer, true> {
+    last_hit_cache() = default;
+    last_hit_cache(const last_hit_cache&) {}
+    last_hit_cache& operator=(const last_hit_cache&) {
+        return *this;
+    }
+
+    EntryPointer last_hit() const {
+        return _last_hit;
+    }
+
+    void remember_hit(EntryPointer hit) {
+        _last_hit = hit;
+    }
+
+    void forget_hit() {
+        _last_hit = nullptr;
+    }
+
+private:
+    EntryPointer _last_hit = nullptr;
+};
+
+enum class rehash_reason : uint8_t {
+    load_factor,
+    max_lookups_overflow,
+    reserve,
+    shrink,
+    explicit_rehash, // rehash() called by the user, or sizing a copy
+    reseed // same bucket count, new hash seed, see hash_is_reseedable
+};
+
+struct rehash_event {
+    bool after; // false for the call just before the new buckets are allocated
+    rehash_reason reason;
+    size_t old_bucket_count;
+    size_t new_bucket_count;
+    size_t num_elements;
+    uint64_t elapsed_ns; // only set in the after call
+};
+
+// A plain function pointer and a context pointer, so an unset listener costs one branch per rehash
+using rehash_listener = void (*)(const rehash_event& event, void* context);
+
+/**
+ * A snapshot of how a faster_hashtable is laid out, returned by faster_hashtable::stats().
+ * distance_histogram[d] counts the elements that sit d slots past their desired slot,
+ * so finding one of them touches d + 1 slots. A rising mean or max probe length at a steady
+ * load factor points at a bad hasher, a max_probe_length close to max_lookups means a grow is near.
+*/
+struct hashtable_stats {
+    std::vector<size_t> distance_histogram;
+    double mean_probe_length = 0; // average _distance_from_desired of the full slots
+    int8_t max_probe_length = 0;
+    size_t longest_cluster = 0; // longest run of consecutive full slots
+    size_t empty_slots = 0;
+    size_t full_slots = 0;
+    size_t slots_scanned = 0;
+    size_t stashed = 0; // elements in the overflow stash, not part of the numbers above
+    int8_t max_lookups = 0;
+    float load_factor = 0;
+};
+
 template <typename T, typename FindKey, 
           typename ArgumentHash, typename Hasher, // AmnesiaHzd: use ArgumentHash to init Hasher
           typename ArgumentEqual, typename Equal,
           typename ArgumentAlloc, typename EntryAlloc>
 // 1.its a has-a relationship, 
 // 2.all the member function and member factor from father class would be hide at this class 
-class faster_hashtable : private EntryAlloc, private Hasher, private Equal { 
+class faster_hashtable : private EntryAlloc, private Hasher, private Equal, private operation_counters,
+                         private last_hit_cache<typename std::allocator_traits<EntryAlloc>::pointer,
+                                                hash_remembers_last_hit<ArgumentHash>::value> { 
     using Entry = faster_table_entry<T>;
     // std::allocator_traits allows you to use allocator function 
     // even current now u dont know the allocate details
@@ -426,7 +739,7 @@ public:
         return *this;
     }
 
-    faster_hashtable& operator=(const faster_hashtable&& other) noexcept {
+    faster_hashtable& operator=(faster_hashtable&& other) noexcept {
         if (this == std::addressof(other)) {
             return *this;
         } else if (AllocatorTraits::propagate_on_container_move_assignment::value) {
@@ -440,12 +753,16 @@ public:
             clear();
 
             _max_load_factor = other._max_load_factor;
+            // the elements are placed by hash, so a seeded hasher has to be other's before the first one goes in
+            static_cast<Hasher&>(*this) = other;
+            static_cast<Equal&>(*this) = other;
             rehash_for_other_container(other);
             for (T& elem : other) {
                 emplace(std::move(elem));
             }
     
             other.clear();
+            return *this;
         }
 
         static_cast<Hasher&>(*this) = std::move(other);
@@ -465,6 +782,13 @@ public:
         return static_cast<const ArgumentHash&>(*this);
     }
 
+protected:
+    // for maps whose comparator owns state they change, like the key arena of arena_string_map
+    ArgumentEqual& mutable_key_eq() {
+        return static_cast<ArgumentEqual&>(*this);
+    }
+
+public:
     ~faster_hashtable() {
         clear();
         deallocate_data(_entries, _num_slots_minus_one, _max_lookups);
@@ -505,7 +829,7 @@ public:
         }
 
         ValueType& operator*() const {
-            return current->value;
+            return current->_value;
         }
 
         ValueType* operator->() const {
@@ -541,11 +865,11 @@ public:
     }
 
     iterator end() {
-        return { _entries + static_cast<ptrdiff_t>(_num_slots_minus_one + _max_lookups) };
+        return { _entries + num_scannable_slots() };
     }
 
     const_iterator end() const {
-        return { _entries + static_cast<ptrdiff_t>(_num_slots_minus_one + _max_lookups) };
+        return { _entries + num_scannable_slots() };
     }
 
     const_iterator cend() const {
@@ -553,18 +877,23 @@ public:
     }
 
     iterator find(const FindKey& key) {
-        size_t index = _hash_policy.index_for_hash(hash_object(key), _num_slots_minus_one);
-        EntryPointer it = _entries + ptrdiff_t(index);
-        for (int8_t distance = 0; it->_distance_from_desired >= distance; ++distance, ++it) {
-            if (compares_equal(key, it->_value)) {
-                return { it };
-            }
+        if (EntryPointer hit = cached_hit(key)) {
+            return { hit };
         }
-        return end();
+        iterator found = find_uncached(key);
+        if (found != end()) {
+            this->remember_hit(found.current);
+        }
+        return found;
     }
 
+    // const lookups read the remembered entry but never replace it, so concurrent readers stay read-only
     const_iterator find(const FindKey& key) const {
-        return const_cast<faster_hashtable*>(this)->find(key);
+        faster_hashtable* self = const_cast<faster_hashtable*>(this);
+        if (EntryPointer hit = self->cached_hit(key)) {
+            return { hit };
+        }
+        return self->find_uncached(key);
     }
 
     size_t count(const FindKey& key) const {
@@ -590,66 +919,47 @@ public:
     }
 
     void rehash(size_t num_buckets) {
-        // step1 caculate the new num of buckets
-        num_buckets = std::max(num_buckets, static_cast<size_t>(std::ceil(_num_elements / static_cast<double>(_max_load_factor))));
-        if (num_buckets == 0) {
-            reset_to_empty_state();
-            return;
-        }
-        if (num_buckets == bucket_count()) { // do not need do anything
-            return;
-        }
-
-        // step2 caculate new prime number and new max lookups
-        auto new_prime_index = _hash_policy.next_size_over(num_buckets);
-        int8_t new_max_lookups = compute_max_lookups(num_buckets);
-
-        // step3 apply new buckets
-        EntryPointer new_buckets(AllocatorTraits::allocate(*this, num_buckets + new_max_lookups)); // Calculate the new maximum number of lookups, based on the new number of buckets
-        EntryPointer special_end_item = new_buckets + static_cast<ptrdiff_t>(num_buckets + new_max_lookups - 1);
-        
-        // step4 swap new and old buctets
-        for (EntryPointer it = new_buckets; it != special_end_item; ++it) {
-            it->_distance_from_desired = -1;
-        }
-        std::swap(_entries, new_buckets);
-        std::swap(_num_slots_minus_one, num_buckets);
-        --_num_slots_minus_one;
-        _hash_policy.commit(new_prime_index); // AmnesiaHzd: how about using move
-
-        int8_t old_max_lookups = _max_lookups;
-        _max_lookups = new_max_lookups; // AmnesiaHzd: how about after deallocate
-        _num_elements = 0;
-
-        // step5 deallocate old buckets
-        for (EntryPointer it = new_buckets, end = it + static_cast<ptrdiff_t>(num_buckets + old_max_lookups); it != end; ++it) {
-            if (it->has_value()) {
-                emplace(std::move(it->_value));
-                it->destroy_value();
-            }
-        }
-        deallocate_data(new_buckets, num_buckets, old_max_lookups);
+        rehash_impl(num_buckets, rehash_reason::explicit_rehash);
     }
 
     void reserve(size_t num_elements) {
         size_t required_buckets = num_buckets_for_reserve(num_elements);
         if (required_buckets > bucket_count()) {
-            rehash(required_buckets);
+            rehash_impl(required_buckets, rehash_reason::reserve);
         }
     }
 
+    // called before and after every rehash of this table, replaces the global listener for it
+    void set_rehash_listener(rehash_listener listener, void* context = nullptr) {
+        _rehash_listener = listener;
+        _rehash_listener_context = context;
+    }
+
+    // called for every table of this type that has no listener of its own,
+    // set it before the tables are used, it is not synchronized
+    static void set_global_rehash_listener(rehash_listener listener, void* context = nullptr) {
+        global_rehash_listener() = std::make_pair(listener, context);
+    }
+
     // the return value is a type that can be converted to an iterator
     // the reason for doing this is that it's not free to find the
     // iterator pointing at the next element. if you care about the
     // next iterator, turn the return value into an iterator
     convertible_to_iterator erase(const_iterator to_erase) {
+        this->forget_hit();
         EntryPointer current = to_erase.current;
         current->destroy_value();
         --_num_elements;
+        if (current >= stash_begin()) {
+            // stashed elements are not part of any probe chain, nothing to shift
+            --_num_stashed;
+            return { to_erase.current };
+        }
 
         for (EntryPointer next = current + ptrdiff_t(1); !next->is_at_desired_position(); ++current, ++next) {
             current->emplace(next->_distance_from_desired - 1, std::move(next->_value));
             next->destroy_value();
+            add_count(table_counter::backward_shift_move);
         }
         return { to_erase.current };
     }
@@ -658,36 +968,43 @@ public:
         if (begin_it == end_it) {
             return { begin_it.current };
         }
+        this->forget_hit();
             
         for (EntryPointer it = begin_it.current, end = end_it.current; it != end; ++it) {
             if (it->has_value()) {
                 it->destroy_value();
                 --_num_elements;
+                if (it >= stash_begin()) {
+                    --_num_stashed;
+                }
             }
         }
         if (end_it == this->end()) {
             return this->end();
         }
             
-        ptrdiff_t num_to_move = std::min(static_cast<ptrdiff_t>(end_it.current->distance_from_desired), end_it.current - begin_it.current);
+        ptrdiff_t num_to_move = std::min(static_cast<ptrdiff_t>(end_it.current->_distance_from_desired), end_it.current - begin_it.current);
         EntryPointer to_return = end_it.current - num_to_move;
         for (EntryPointer it = end_it.current; !it->is_at_desired_position();) {
             EntryPointer target = it - num_to_move;
-            target->emplace(it->distance_from_desired - num_to_move, std::move(it->value));
+            target->emplace(it->_distance_from_desired - num_to_move, std::move(it->_value));
             it->destroy_value();
+            add_count(table_counter::backward_shift_move);
             ++it;
-            num_to_move = std::min(static_cast<ptrdiff_t>(it->distance_from_desired), num_to_move);
+            num_to_move = std::min(static_cast<ptrdiff_t>(it->_distance_from_desired), num_to_move);
         }
         return { to_return };
     }
 
     void clear() {
-        for (EntryPointer it = _entries, end = it + static_cast<ptrdiff_t>(_num_slots_minus_one + _max_lookups); it != end; ++it) {
+        this->forget_hit();
+        for (EntryPointer it = _entries, end = it + num_scannable_slots(); it != end; ++it) {
             if (it->has_value()) {
                 it->destroy_value();
             }
         }
         _num_elements = 0;
+        _num_stashed = 0;
     }
 
     size_t erase(const FindKey& key) {
@@ -701,7 +1018,7 @@ public:
     }
 
     void shrink_to_fit() {
-        rehash_for_other_container(*this);
+        rehash_for_other_container(*this, rehash_reason::shrink);
     }
 
     void swap(faster_hashtable& other) {
@@ -755,21 +1072,99 @@ public:
         return _num_elements == 0;
     }
 
-    template<typename Key, typename ...Args>
-    std::pair<iterator, bool> emplace(Key&& key, Args&& ...args) {
-        // step1: get the index of new key
-        size_t index = _hash_policy.index_for_hash(hash_object(key), _num_slots_minus_one);
-        
-        // step2: check the key if it has already in the hashtable
-        EntryPointer current_entry = _entries + ptrdiff_t(index);
-        int8_t distance_from_desired = 0;
-        for (; current_entry->_distance_from_desired >= distance_from_desired; ++current_entry, ++distance_from_desired) {
-            if (compares_equal(key, current_entry->_value)) {
-                return std::make_pair(current_entry, false);
+    // walks every slot, O(bucket_count())
+    hashtable_stats stats() const {
+        hashtable_stats result = start_stats();
+        size_t cluster = 0;
+        for (EntryPointer it = _entries, end = stash_begin(); it != end; ++it) {
+            cluster = it->has_value() ? cluster + 1 : 0;
+            result.longest_cluster = std::max(result.longest_cluster, cluster);
+            add_to_stats(result, *it);
+        }
+        finish_stats(result);
+        return result;
+    }
+
+    // looks at num_samples evenly spaced slots, cheap enough to call from a metrics exporter.
+    // the histogram and the slot counts only cover the samples, and longest_cluster
+    // only follows each sampled run for up to max_lookups slots
+    hashtable_stats stats(size_t num_samples) const {
+        ptrdiff_t num_slots = stash_begin() - _entries;
+        if (num_samples == 0 || num_samples >= static_cast<size_t>(num_slots)) {
+            return stats();
+        }
+
+        hashtable_stats result = start_stats();
+        ptrdiff_t stride = num_slots / static_cast<ptrdiff_t>(num_samples);
+        EntryPointer end = _entries + num_slots;
+        EntryPointer it = _entries;
+        for (size_t i = 0; i < num_samples; ++i, it += stride) {
+            size_t cluster = 0;
+            for (EntryPointer run = it; run != end && run->has_value() && cluster < static_cast<size_t>(_max_lookups); ++run) {
+                ++cluster;
             }
+            result.longest_cluster = std::max(result.longest_cluster, cluster);
+            add_to_stats(result, *it);
         }
+        finish_stats(result);
+        return result;
+    }
 
-        return emplace_new_key(distance_from_desired, current_entry, std::forward<Key>(key), std::forward<Args>(args)...);
+    // writes one CSV row per region of slots_per_region slots:
+    // first_slot,slots,full,fill_ratio,max_distance,mean_distance
+    // src/occupancy_heatmap.cpp renders the output as a text heat map
+    void dump_occupancy(std::ostream& out, size_t slots_per_region = 64) const {
+        slots_per_region = std::max(slots_per_region, static_cast<size_t>(1));
+        out << "first_slot,slots,full,fill_ratio,max_distance,mean_distance\n";
+        size_t num_slots = static_cast<size_t>(stash_begin() - _entries);
+        for (size_t first = 0; first < num_slots; first += slots_per_region) {
+            size_t slots = std::min(slots_per_region, num_slots - first);
+            size_t full = 0;
+            size_t distance_sum = 0;
+            int max_distance = 0;
+            for (EntryPointer it = _entries + ptrdiff_t(first), end = it + ptrdiff_t(slots); it != end; ++it) {
+                if (it->has_value()) {
+                    ++full;
+                    distance_sum += static_cast<size_t>(it->_distance_from_desired);
+                    max_distance = std::max(max_distance, static_cast<int>(it->_distance_from_desired));
+                }
+            }
+            out << first << ',' << slots << ',' << full << ','
+                << static_cast<double>(full) / slots << ',' << max_distance << ','
+                << (full ? static_cast<double>(distance_sum) / full : 0.0) << '\n';
+        }
+    }
+
+    // totals of the operations done through this table, see operation_counters
+    operation_counts counters() const {
+        return read_counts();
+    }
+
+    // bytes of the bucket array: every slot, the max_lookups padding, the overflow stash and the special end item
+    size_t memory_usage() const {
+        if (_entries == Entry::empty_default_table()) {
+            return 0;
+        }
+        return static_cast<size_t>(num_scannable_slots() + 1) * sizeof(Entry);
+    }
+
+    // memory_usage() plus the heap memory owned by the elements, see owned_heap_bytes, O(size())
+    size_t deep_memory_usage() const {
+        size_t result = memory_usage();
+        for (const T& value : *this) {
+            result += owned_heap_bytes_of(value);
+        }
+        return result;
+    }
+
+    template<typename Key, typename ...Args>
+    std::pair<iterator, bool> emplace(Key&& key, Args&& ...args) {
+        if (EntryPointer hit = cached_hit(key)) {
+            return std::make_pair(iterator{ hit }, false);
+        }
+        std::pair<iterator, bool> result = emplace_uncached(std::forward<Key>(key), std::forward<Args>(args)...);
+        this->remember_hit(result.first.current);
+        return result;
     }
 
     template<typename... Args>
@@ -795,13 +1190,40 @@ public:
         return emplace(std::move(value)).first;
     }
 
+    template<typename It>
+    void insert(It begin, It end) {
+        for (; begin != end; ++begin) {
+            emplace(*begin);
+        }
+    }
+
+    void insert(std::initializer_list<value_type> initializer_list) {
+        insert(initializer_list.begin(), initializer_list.end());
+    }
+
 private:
     EntryPointer _entries = Entry::empty_default_table();
     size_t _num_slots_minus_one = 0;
-    typename HashPolicySelector<ArgumentHash>::type _hash_policy;
+    typename HashPolicySelector<ArgumentHash, FindKey>::type _hash_policy;
     int8_t _max_lookups = ddaof::min_lookups - 1;
+    bool _reseeded = false; // already tried a new seed at this bucket count
     float _max_load_factor = 0.5f;
     size_t _num_elements = 0;
+    size_t _num_stashed = 0;
+    rehash_listener _rehash_listener = nullptr;
+    void* _rehash_listener_context = nullptr;
+
+    static std::pair<rehash_listener, void*>& global_rehash_listener() {
+        static std::pair<rehash_listener, void*> listener(nullptr, nullptr);
+        return listener;
+    }
+
+    std::pair<rehash_listener, void*> current_rehash_listener() const {
+        if (_rehash_listener) {
+            return std::make_pair(_rehash_listener, _rehash_listener_context);
+        }
+        return global_rehash_listener();
+    }
 
     static int8_t compute_max_lookups(size_t num_buckets) {
         int8_t desired = log2(num_buckets);
@@ -813,19 +1235,90 @@ private:
         return static_cast<size_t>(std::ceil(num_elements / std::min(0.5, static_cast<double>(_max_load_factor))));
     }
 
-    void rehash_for_other_container(const faster_hashtable& other) {
-        rehash(std::min(num_buckets_for_reserve(other.size()), other.bucket_count()));
+    void rehash_impl(size_t num_buckets, rehash_reason reason) {
+        // step1 caculate the new num of buckets
+        num_buckets = std::max(num_buckets, static_cast<size_t>(std::ceil(_num_elements / static_cast<double>(_max_load_factor))));
+        if (num_buckets == 0) {
+            reset_to_empty_state();
+            return;
+        }
+        if (num_buckets == bucket_count() && reason != rehash_reason::reseed) { // do not need do anything
+            return;
+        }
+
+        // step2 caculate new prime number and new max lookups, the cached hit is about to move
+        // and the reinserts below bypass the cache
+        this->forget_hit();
+        auto new_prime_index = _hash_policy.next_size_over(num_buckets);
+        int8_t new_max_lookups = compute_max_lookups(num_buckets);
+
+        std::pair<rehash_listener, void*> listener = current_rehash_listener();
+        rehash_event event = { false, reason, bucket_count(), num_buckets, _num_elements, 0 };
+        std::chrono::steady_clock::time_point start;
+        if (listener.first) {
+            listener.first(event, listener.second);
+            start = std::chrono::steady_clock::now();
+        }
+
+        // step3 apply new buckets, the overflow stash goes right before the special end item
+        size_t num_new_entries = num_buckets + new_max_lookups + stash_capacity(num_buckets - 1, new_max_lookups);
+        EntryPointer new_buckets(AllocatorTraits::allocate(*this, num_new_entries)); // Calculate the new maximum number of lookups, based on the new number of buckets
+        add_count(table_counter::bytes_allocated, num_new_entries * sizeof(Entry));
+        EntryPointer special_end_item = new_buckets + static_cast<ptrdiff_t>(num_new_entries - 1);
+        
+        // step4 swap new and old buctets
+        for (EntryPointer it = new_buckets; it != special_end_item; ++it) {
+            it->_distance_from_desired = -1;
+        }
+        special_end_item->_distance_from_desired = Entry::_special_end_value;
+        std::swap(_entries, new_buckets);
+        std::swap(_num_slots_minus_one, num_buckets);
+        --_num_slots_minus_one;
+        _hash_policy.commit(new_prime_index); // AmnesiaHzd: how about using move
+
+        int8_t old_max_lookups = _max_lookups;
+        _max_lookups = new_max_lookups; // AmnesiaHzd: how about after deallocate
+        _num_elements = 0;
+        _num_stashed = 0;
+        if (reason != rehash_reason::reseed) {
+            _reseeded = false;
+        }
+
+        // step5 deallocate old buckets
+        ptrdiff_t num_old_slots = static_cast<ptrdiff_t>(num_buckets + old_max_lookups + stash_capacity(num_buckets, old_max_lookups));
+        for (EntryPointer it = new_buckets, end = it + num_old_slots; it != end; ++it) {
+            if (it->has_value()) {
+                emplace_uncached(std::move(it->_value));
+                it->destroy_value();
+            }
+        }
+        deallocate_data(new_buckets, num_buckets, old_max_lookups);
+
+        if (listener.first) {
+            event.after = true;
+            event.elapsed_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+            listener.first(event, listener.second);
+        }
+    }
+
+    void rehash_for_other_container(const faster_hashtable& other, rehash_reason reason = rehash_reason::explicit_rehash) {
+        rehash_impl(std::min(num_buckets_for_reserve(other.size()), other.bucket_count()), reason);
     }
 
     // swap all
     void swap_pointers(faster_hashtable& other) {
         using std::swap;
-        swap(_hash_policy, other.hash_policy);
-        swap(_entries, other.entries);
-        swap(_num_slots_minus_one, other.num_slots_minus_one);
-        swap(_num_elements, other.num_elements);
-        swap(_max_lookups, other.max_lookups);
+        swap(_hash_policy, other._hash_policy);
+        swap(_entries, other._entries);
+        swap(_num_slots_minus_one, other._num_slots_minus_one);
+        swap(_num_elements, other._num_elements);
+        swap(_num_stashed, other._num_stashed);
+        swap(_max_lookups, other._max_lookups);
+        swap(_reseeded, other._reseeded);
         swap(_max_load_factor, other._max_load_factor);
+        this->forget_hit();
+        other.forget_hit();
     }
     
     template<typename Key, typename... Args>
@@ -833,10 +1326,19 @@ private:
     emplace_new_key(int8_t distance_from_desired, EntryPointer current_entry, Key&& key, Args&&... args) {
         using std::swap;
         if (_num_slots_minus_one == 0 
-                || distance_from_desired == _max_lookups 
                 || _num_elements + 1 > (_num_slots_minus_one + 1) * static_cast<double>(_max_load_factor)) {
-            grow();
-            return emplace(std::forward<Key>(key), std::forward<Args>(args)...);
+            grow(rehash_reason::load_factor);
+            return emplace_uncached(std::forward<Key>(key), std::forward<Args>(args)...);
+        } else if (distance_from_desired == _max_lookups) {
+            // a probe chain ran out, the stash absorbs a few of those before the table has to grow
+            EntryPointer stash_slot = free_stash_slot();
+            if (stash_slot == end()) {
+                grow(rehash_reason::max_lookups_overflow);
+                return emplace_uncached(std::forward<Key>(key), std::forward<Args>(args)...);
+            }
+            stash_slot->emplace(0, std::forward<Key>(key), std::forward<Args>(args)...);
+            add_to_stash_counts();
+            return std::make_pair(stash_slot, true);
         } else if (current_entry->is_empty()) {
             current_entry->emplace(distance_from_desired, std::forward<Key>(key), std::forward<Args>(args)...);
             ++_num_elements;
@@ -846,6 +1348,7 @@ private:
         value_type to_insert(std::forward<Key>(key), std::forward<Args>(args)...);
         swap(distance_from_desired, current_entry->_distance_from_desired);
         swap(to_insert, current_entry->_value);
+        add_count(table_counter::robin_hood_swap);
         iterator result = { current_entry };
 
         for (++distance_from_desired, ++current_entry;; ++current_entry) {
@@ -856,25 +1359,189 @@ private:
             } else if (current_entry->_distance_from_desired < distance_from_desired) {
                 swap(distance_from_desired, current_entry->_distance_from_desired);
                 swap(to_insert, current_entry->_value);
+                add_count(table_counter::robin_hood_swap);
                 ++distance_from_desired;
             } else {
                 ++distance_from_desired;
                 if (distance_from_desired == _max_lookups) {
+                    // the element pushed off the end of the chain goes to the stash instead
+                    EntryPointer stash_slot = free_stash_slot();
+                    if (stash_slot != end()) {
+                        stash_slot->emplace(0, std::move(to_insert));
+                        add_to_stash_counts();
+                        return { result, true };
+                    }
                     swap(to_insert, result.current->_value);
-                    grow();
-                    return emplace(std::move(to_insert));
+                    grow(rehash_reason::max_lookups_overflow);
+                    return emplace_uncached(std::move(to_insert));
                 }
             }
         }
     }
 
-    void grow() { 
-        rehash(std::max(size_t(4), 2 * bucket_count()));
+    void grow(rehash_reason reason) { 
+        if (reason == rehash_reason::max_lookups_overflow && try_reseed(hash_is_reseedable<ArgumentHash>())) {
+            return;
+        }
+        add_count(reason == rehash_reason::max_lookups_overflow ? table_counter::grow_for_max_lookups : table_counter::grow_for_load);
+        rehash_impl(_hash_policy.grow_size(bucket_count()), reason);
+    }
+
+    bool try_reseed(std::false_type) {
+        return false;
+    }
+
+    // the stash is full but the load is fine, so the keys are colliding on purpose or by bad luck.
+    // a new seed fixes both, doubling the buckets would fix neither
+    bool try_reseed(std::true_type) {
+        if (_reseeded) {
+            return false;
+        }
+        _reseeded = true;
+        add_count(table_counter::reseed);
+        static_cast<ArgumentHash&>(*this).reseed();
+        rehash_impl(bucket_count(), rehash_reason::reseed);
+        return true;
+    }
+
+    // the overflow stash holds up to max_lookups elements whose probe chain ran out,
+    // it sits between the last probe slot and the special end item. the stashed entries store
+    // a distance of 0, so probes and backward shifts coming from the main slots stop in front of it
+    static int8_t stash_capacity(size_t num_slots_minus_one, int8_t max_lookups) {
+        return num_slots_minus_one ? max_lookups : 0;
+    }
+
+    EntryPointer stash_begin() const {
+        return _entries + static_cast<ptrdiff_t>(_num_slots_minus_one + _max_lookups);
+    }
+
+    iterator find_uncached(const FindKey& key) {
+        size_t index = _hash_policy.index_for_hash(hash_object(key), _num_slots_minus_one);
+        EntryPointer it = _entries + ptrdiff_t(index);
+        int8_t distance = 0;
+        for (; it->_distance_from_desired >= distance; ++distance, ++it) {
+            if (compares_equal(key, it->_value)) {
+                add_count(table_counter::find_hit);
+                add_count(table_counter::probe_step, distance + 1);
+                return { it };
+            }
+        }
+        ptrdiff_t probe_steps = distance + 1;
+        if (_num_stashed) {
+            // a hit scans the stash up to its slot, a miss scans all of it
+            iterator stashed = find_in_stash(key);
+            bool found = stashed != end();
+            probe_steps += (found ? stashed.current + 1 : stashed.current) - stash_begin();
+            if (found) {
+                add_count(table_counter::find_hit);
+                add_count(table_counter::probe_step, static_cast<uint64_t>(probe_steps));
+                return stashed;
+            }
+        }
+        add_count(table_counter::find_miss);
+        add_count(table_counter::probe_step, static_cast<uint64_t>(probe_steps));
+        return end();
+    }
+
+    // emplace without last_hit_cache, for rehash_impl and the retries after a grow
+    template<typename Key, typename ...Args>
+    std::pair<iterator, bool> emplace_uncached(Key&& key, Args&& ...args) {
+        // step1: get the index of new key
+        size_t index = _hash_policy.index_for_hash(hash_object(key), _num_slots_minus_one);
+
+        // step2: check the key if it has already in the hashtable
+        EntryPointer current_entry = _entries + ptrdiff_t(index);
+        int8_t distance_from_desired = 0;
+        for (; current_entry->_distance_from_desired >= distance_from_desired; ++current_entry, ++distance_from_desired) {
+            if (compares_equal(key, current_entry->_value)) {
+                return std::make_pair(current_entry, false);
+            }
+        }
+        if (_num_stashed) {
+            iterator stashed = find_in_stash(key);
+            if (stashed != end()) {
+                return std::make_pair(stashed, false);
+            }
+        }
+
+        return emplace_new_key(distance_from_desired, current_entry, std::forward<Key>(key), std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    EntryPointer cached_hit(const U& key) {
+        EntryPointer hit = this->last_hit();
+        if (hit && hit->has_value() && compares_equal(key, hit->_value)) {
+            add_count(table_counter::last_hit);
+            return hit;
+        }
+        return nullptr;
+    }
+
+    template<typename U>
+    iterator find_in_stash(const U& key) {
+        for (EntryPointer it = stash_begin(), end = _entries + num_scannable_slots(); it != end; ++it) {
+            if (it->has_value() && compares_equal(key, it->_value)) {
+                return { it };
+            }
+        }
+        return end();
+    }
+
+    // end() when the stash is full
+    EntryPointer free_stash_slot() {
+        EntryPointer it = stash_begin(), end = _entries + num_scannable_slots();
+        while (it != end && it->has_value()) {
+            ++it;
+        }
+        return it;
+    }
+
+    void add_to_stash_counts() {
+        ++_num_elements;
+        ++_num_stashed;
+        add_count(table_counter::stash_insert);
+    }
+
+    // every slot but the special end item
+    ptrdiff_t num_scannable_slots() const {
+        return static_cast<ptrdiff_t>(_num_slots_minus_one + _max_lookups + stash_capacity(_num_slots_minus_one, _max_lookups));
+    }
+
+    hashtable_stats start_stats() const {
+        hashtable_stats result;
+        result.distance_histogram.resize(static_cast<size_t>(std::max(_max_lookups, ddaof::min_lookups)));
+        result.max_lookups = _max_lookups;
+        result.stashed = _num_stashed;
+        result.load_factor = load_factor();
+        return result;
+    }
+
+    void add_to_stats(hashtable_stats& result, const Entry& entry) const {
+        ++result.slots_scanned;
+        if (entry.is_empty()) {
+            ++result.empty_slots;
+            return;
+        }
+
+        size_t distance = static_cast<size_t>(entry._distance_from_desired);
+        if (distance >= result.distance_histogram.size()) {
+            result.distance_histogram.resize(distance + 1);
+        }
+        ++result.distance_histogram[distance];
+        ++result.full_slots;
+        result.mean_probe_length += distance;
+        result.max_probe_length = std::max(result.max_probe_length, entry._distance_from_desired);
+    }
+
+    void finish_stats(hashtable_stats& result) const {
+        if (result.full_slots) {
+            result.mean_probe_length /= result.full_slots;
+        }
     }
 
     void deallocate_data(EntryPointer begin, size_t num_slots_minus_one, int8_t max_lookups) {
         if (begin != Entry::empty_default_table()) {
-            AllocatorTraits::deallocate(*this, begin, num_slots_minus_one + max_lookups + 1); // ?
+            AllocatorTraits::deallocate(*this, begin, num_slots_minus_one + max_lookups + stash_capacity(num_slots_minus_one, max_lookups) + 1);
         }
     }
 
@@ -884,6 +1551,9 @@ private:
         _num_slots_minus_one = 0;
         _hash_policy.reset();
         _max_lookups = ddaof::min_lookups - 1;
+        _num_stashed = 0;
+        _reseeded = false;
+        this->forget_hit();
         return;
     }
 
@@ -899,6 +1569,7 @@ private:
 
     template<typename L, typename R>
     bool compares_equal(const L& lhs, const R& rhs) {
+        add_count(table_counter::compare);
         return static_cast<Equal&>(*this)(lhs, rhs);
     }
 
@@ -925,197 +1596,16 @@ private:
 };
 
 struct prime_number_hash_policy {
-    static size_t mod0(size_t) { return 0llu; }
-    static size_t mod2(size_t hash) { return hash % 2llu; }
-    static size_t mod3(size_t hash) { return hash % 3llu; }
-    static size_t mod5(size_t hash) { return hash % 5llu; }
-    static size_t mod7(size_t hash) { return hash % 7llu; }
-    static size_t mod11(size_t hash) { return hash % 11llu; }
-    static size_t mod13(size_t hash) { return hash % 13llu; }
-    static size_t mod17(size_t hash) { return hash % 17llu; }
-    static size_t mod23(size_t hash) { return hash % 23llu; }
-    static size_t mod29(size_t hash) { return hash % 29llu; }
-    static size_t mod37(size_t hash) { return hash % 37llu; }
-    static size_t mod47(size_t hash) { return hash % 47llu; }
-    static size_t mod59(size_t hash) { return hash % 59llu; }
-    static size_t mod73(size_t hash) { return hash % 73llu; }
-    static size_t mod97(size_t hash) { return hash % 97llu; }
-    static size_t mod127(size_t hash) { return hash % 127llu; }
-    static size_t mod151(size_t hash) { return hash % 151llu; }
-    static size_t mod197(size_t hash) { return hash % 197llu; }
-    static size_t mod251(size_t hash) { return hash % 251llu; }
-    static size_t mod313(size_t hash) { return hash % 313llu; }
-    static size_t mod397(size_t hash) { return hash % 397llu; }
-    static size_t mod499(size_t hash) { return hash % 499llu; }
-    static size_t mod631(size_t hash) { return hash % 631llu; }
-    static size_t mod797(size_t hash) { return hash % 797llu; }
-    static size_t mod1009(size_t hash) { return hash % 1009llu; }
-    static size_t mod1259(size_t hash) { return hash % 1259llu; }
-    static size_t mod1597(size_t hash) { return hash % 1597llu; }
-    static size_t mod2011(size_t hash) { return hash % 2011llu; }
-    static size_t mod2539(size_t hash) { return hash % 2539llu; }
-    static size_t mod3203(size_t hash) { return hash % 3203llu; }
-    static size_t mod4027(size_t hash) { return hash % 4027llu; }
-    static size_t mod5087(size_t hash) { return hash % 5087llu; }
-    static size_t mod6421(size_t hash) { return hash % 6421llu; }
-    static size_t mod8089(size_t hash) { return hash % 8089llu; }
-    static size_t mod10193(size_t hash) { return hash % 10193llu; }
-    static size_t mod12853(size_t hash) { return hash % 12853llu; }
-    static size_t mod16193(size_t hash) { return hash % 16193llu; }
-    static size_t mod20399(size_t hash) { return hash % 20399llu; }
-    static size_t mod25717(size_t hash) { return hash % 25717llu; }
-    static size_t mod32401(size_t hash) { return hash % 32401llu; }
-    static size_t mod40823(size_t hash) { return hash % 40823llu; }
-    static size_t mod51437(size_t hash) { return hash % 51437llu; }
-    static size_t mod64811(size_t hash) { return hash % 64811llu; }
-    static size_t mod81649(size_t hash) { return hash % 81649llu; }
-    static size_t mod102877(size_t hash) { return hash % 102877llu; }
-    static size_t mod129607(size_t hash) { return hash % 129607llu; }
-    static size_t mod163307(size_t hash) { return hash % 163307llu; }
-    static size_t mod205759(size_t hash) { return hash % 205759llu; }
-    static size_t mod259229(size_t hash) { return hash % 259229llu; }
-    static size_t mod326617(size_t hash) { return hash % 326617llu; }
-    static size_t mod411527(size_t hash) { return hash % 411527llu; }
-    static size_t mod518509(size_t hash) { return hash % 518509llu; }
-    static size_t mod653267(size_t hash) { return hash % 653267llu; }
-    static size_t mod823117(size_t hash) { return hash % 823117llu; }
-    static size_t mod1037059(size_t hash) { return hash % 1037059llu; }
-    static size_t mod1306601(size_t hash) { return hash % 1306601llu; }
-    static size_t mod1646237(size_t hash) { return hash % 1646237llu; }
-    static size_t mod2074129(size_t hash) { return hash % 2074129llu; }
-    static size_t mod2613229(size_t hash) { return hash % 2613229llu; }
-    static size_t mod3292489(size_t hash) { return hash % 3292489llu; }
-    static size_t mod4148279(size_t hash) { return hash % 4148279llu; }
-    static size_t mod5226491(size_t hash) { return hash % 5226491llu; }
-    static size_t mod6584983(size_t hash) { return hash % 6584983llu; }
-    static size_t mod8296553(size_t hash) { return hash % 8296553llu; }
-    static size_t mod10453007(size_t hash) { return hash % 10453007llu; }
-    static size_t mod13169977(size_t hash) { return hash % 13169977llu; }
-    static size_t mod16593127(size_t hash) { return hash % 16593127llu; }
-    static size_t mod20906033(size_t hash) { return hash % 20906033llu; }
-    static size_t mod26339969(size_t hash) { return hash % 26339969llu; }
-    static size_t mod33186281(size_t hash) { return hash % 33186281llu; }
-    static size_t mod41812097(size_t hash) { return hash % 41812097llu; }
-    static size_t mod52679969(size_t hash) { return hash % 52679969llu; }
-    static size_t mod66372617(size_t hash) { return hash % 66372617llu; }
-    static size_t mod83624237(size_t hash) { return hash % 83624237llu; }
-    static size_t mod105359939(size_t hash) { return hash % 105359939llu; }
-    static size_t mod132745199(size_t hash) { return hash % 132745199llu; }
-    static size_t mod167248483(size_t hash) { return hash % 167248483llu; }
-    static size_t mod210719881(size_t hash) { return hash % 210719881llu; }
-    static size_t mod265490441(size_t hash) { return hash % 265490441llu; }
-    static size_t mod334496971(size_t hash) { return hash % 334496971llu; }
-    static size_t mod421439783(size_t hash) { return hash % 421439783llu; }
-    static size_t mod530980861(size_t hash) { return hash % 530980861llu; }
-    static size_t mod668993977(size_t hash) { return hash % 668993977llu; }
-    static size_t mod842879579(size_t hash) { return hash % 842879579llu; }
-    static size_t mod1061961721(size_t hash) { return hash % 1061961721llu; }
-    static size_t mod1337987929(size_t hash) { return hash % 1337987929llu; }
-    static size_t mod1685759167(size_t hash) { return hash % 1685759167llu; }
-    static size_t mod2123923447(size_t hash) { return hash % 2123923447llu; }
-    static size_t mod2675975881(size_t hash) { return hash % 2675975881llu; }
-    static size_t mod3371518343(size_t hash) { return hash % 3371518343llu; }
-    static size_t mod4247846927(size_t hash) { return hash % 4247846927llu; }
-    static size_t mod5351951779(size_t hash) { return hash % 5351951779llu; }
-    static size_t mod6743036717(size_t hash) { return hash % 6743036717llu; }
-    static size_t mod8495693897(size_t hash) { return hash % 8495693897llu; }
-    static size_t mod10703903591(size_t hash) { return hash % 10703903591llu; }
-    static size_t mod13486073473(size_t hash) { return hash % 13486073473llu; }
-    static size_t mod16991387857(size_t hash) { return hash % 16991387857llu; }
-    static size_t mod21407807219(size_t hash) { return hash % 21407807219llu; }
-    static size_t mod26972146961(size_t hash) { return hash % 26972146961llu; }
-    static size_t mod33982775741(size_t hash) { return hash % 33982775741llu; }
-    static size_t mod42815614441(size_t hash) { return hash % 42815614441llu; }
-    static size_t mod53944293929(size_t hash) { return hash % 53944293929llu; }
-    static size_t mod67965551447(size_t hash) { return hash % 67965551447llu; }
-    static size_t mod85631228929(size_t hash) { return hash % 85631228929llu; }
-    static size_t mod107888587883(size_t hash) { return hash % 107888587883llu; }
-    static size_t mod135931102921(size_t hash) { return hash % 135931102921llu; }
-    static size_t mod171262457903(size_t hash) { return hash % 171262457903llu; }
-    static size_t mod215777175787(size_t hash) { return hash % 215777175787llu; }
-    static size_t mod271862205833(size_t hash) { return hash % 271862205833llu; }
-    static size_t mod342524915839(size_t hash) { return hash % 342524915839llu; }
-    static size_t mod431554351609(size_t hash) { return hash % 431554351609llu; }
-    static size_t mod543724411781(size_t hash) { return hash % 543724411781llu; }
-    static size_t mod685049831731(size_t hash) { return hash % 685049831731llu; }
-    static size_t mod863108703229(size_t hash) { return hash % 863108703229llu; }
-    static size_t mod1087448823553(size_t hash) { return hash % 1087448823553llu; }
-    static size_t mod1370099663459(size_t hash) { return hash % 1370099663459llu; }
-    static size_t mod1726217406467(size_t hash) { return hash % 1726217406467llu; }
-    static size_t mod2174897647073(size_t hash) { return hash % 2174897647073llu; }
-    static size_t mod2740199326961(size_t hash) { return hash % 2740199326961llu; }
-    static size_t mod3452434812973(size_t hash) { return hash % 3452434812973llu; }
-    static size_t mod4349795294267(size_t hash) { return hash % 4349795294267llu; }
-    static size_t mod5480398654009(size_t hash) { return hash % 5480398654009llu; }
-    static size_t mod6904869625999(size_t hash) { return hash % 6904869625999llu; }
-    static size_t mod8699590588571(size_t hash) { return hash % 8699590588571llu; }
-    static size_t mod10960797308051(size_t hash) { return hash % 10960797308051llu; }
-    static size_t mod13809739252051(size_t hash) { return hash % 13809739252051llu; }
-    static size_t mod17399181177241(size_t hash) { return hash % 17399181177241llu; }
-    static size_t mod21921594616111(size_t hash) { return hash % 21921594616111llu; }
-    static size_t mod27619478504183(size_t hash) { return hash % 27619478504183llu; }
-    static size_t mod34798362354533(size_t hash) { return hash % 34798362354533llu; }
-    static size_t mod43843189232363(size_t hash) { return hash % 43843189232363llu; }
-    static size_t mod55238957008387(size_t hash) { return hash % 55238957008387llu; }
-    static size_t mod69596724709081(size_t hash) { return hash % 69596724709081llu; }
-    static size_t mod87686378464759(size_t hash) { return hash % 87686378464759llu; }
-    static size_t mod110477914016779(size_t hash) { return hash % 110477914016779llu; }
-    static size_t mod139193449418173(size_t hash) { return hash % 139193449418173llu; }
-    static size_t mod175372756929481(size_t hash) { return hash % 175372756929481llu; }
-    static size_t mod220955828033581(size_t hash) { return hash % 220955828033581llu; }
-    static size_t mod278386898836457(size_t hash) { return hash % 278386898836457llu; }
-    static size_t mod350745513859007(size_t hash) { return hash % 350745513859007llu; }
-    static size_t mod441911656067171(size_t hash) { return hash % 441911656067171llu; }
-    static size_t mod556773797672909(size_t hash) { return hash % 556773797672909llu; }
-    static size_t mod701491027718027(size_t hash) { return hash % 701491027718027llu; }
-    static size_t mod883823312134381(size_t hash) { return hash % 883823312134381llu; }
-    static size_t mod1113547595345903(size_t hash) { return hash % 1113547595345903llu; }
-    static size_t mod1402982055436147(size_t hash) { return hash % 1402982055436147llu; }
-    static size_t mod1767646624268779(size_t hash) { return hash % 1767646624268779llu; }
-    static size_t mod2227095190691797(size_t hash) { return hash % 2227095190691797llu; }
-    static size_t mod2805964110872297(size_t hash) { return hash % 2805964110872297llu; }
-    static size_t mod3535293248537579(size_t hash) { return hash % 3535293248537579llu; }
-    static size_t mod4454190381383713(size_t hash) { return hash % 4454190381383713llu; }
-    static size_t mod5611928221744609(size_t hash) { return hash % 5611928221744609llu; }
-    static size_t mod7070586497075177(size_t hash) { return hash % 7070586497075177llu; }
-    static size_t mod8908380762767489(size_t hash) { return hash % 8908380762767489llu; }
-    static size_t mod11223856443489329(size_t hash) { return hash % 11223856443489329llu; }
-    static size_t mod14141172994150357(size_t hash) { return hash % 14141172994150357llu; }
-    static size_t mod17816761525534927(size_t hash) { return hash % 17816761525534927llu; }
-    static size_t mod22447712886978529(size_t hash) { return hash % 22447712886978529llu; }
-    static size_t mod28282345988300791(size_t hash) { return hash % 28282345988300791llu; }
-    static size_t mod35633523051069991(size_t hash) { return hash % 35633523051069991llu; }
-    static size_t mod44895425773957261(size_t hash) { return hash % 44895425773957261llu; }
-    static size_t mod56564691976601587(size_t hash) { return hash % 56564691976601587llu; }
-    static size_t mod71267046102139967(size_t hash) { return hash % 71267046102139967llu; }
-    static size_t mod89790851547914507(size_t hash) { return hash % 89790851547914507llu; }
-    static size_t mod113129383953203213(size_t hash) { return hash % 113129383953203213llu; }
-    static size_t mod142534092204280003(size_t hash) { return hash % 142534092204280003llu; }
-    static size_t mod179581703095829107(size_t hash) { return hash % 179581703095829107llu; }
-    static size_t mod226258767906406483(size_t hash) { return hash % 226258767906406483llu; }
-    static size_t mod285068184408560057(size_t hash) { return hash % 285068184408560057llu; }
-    static size_t mod359163406191658253(size_t hash) { return hash % 359163406191658253llu; }
-    static size_t mod452517535812813007(size_t hash) { return hash % 452517535812813007llu; }
-    static size_t mod570136368817120201(size_t hash) { return hash % 570136368817120201llu; }
-    static size_t mod718326812383316683(size_t hash) { return hash % 718326812383316683llu; }
-    static size_t mod905035071625626043(size_t hash) { return hash % 905035071625626043llu; }
-    static size_t mod1140272737634240411(size_t hash) { return hash % 1140272737634240411llu; }
-    static size_t mod1436653624766633509(size_t hash) { return hash % 1436653624766633509llu; }
-    static size_t mod1810070143251252131(size_t hash) { return hash % 1810070143251252131llu; }
-    static size_t mod2280545475268481167(size_t hash) { return hash % 2280545475268481167llu; }
-    static size_t mod2873307249533267101(size_t hash) { return hash % 2873307249533267101llu; }
-    static size_t mod3620140286502504283(size_t hash) { return hash % 3620140286502504283llu; }
-    static size_t mod4561090950536962147(size_t hash) { return hash % 4561090950536962147llu; }
-    static size_t mod5746614499066534157(size_t hash) { return hash % 5746614499066534157llu; }
-    static size_t mod7240280573005008577(size_t hash) { return hash % 7240280573005008577llu; }
-    static size_t mod9122181901073924329(size_t hash) { return hash % 9122181901073924329llu; }
-    static size_t mod11493228998133068689(size_t hash) { return hash % 11493228998133068689llu; }
-    static size_t mod14480561146010017169(size_t hash) { return hash % 14480561146010017169llu; }
-    static size_t mod18446744073709551557(size_t hash) { return hash % 18446744073709551557llu; }
-
-    using mod_function = size_t (*)(size_t);
-
-    mod_function next_size_over(size_t& size) const {
+    // hash % prime without a division, libdivide's "branchfree" scheme:
+    // q = mul_high(hash, magic), hash / prime = (((hash - q) >> 1) + q) >> shift
+    // so the remainder costs two multiplies, a few shifts and a subtract, all inline
+    struct prime_divisor {
+        size_t prime;
+        uint64_t magic;
+        int8_t shift;
+    };
+
+    prime_divisor next_size_over(size_t& size) const {
         // prime numbers generated by the following method:
         // 1. start with a prime p = 2
         // 2. go to wolfram alpha and get p = NextPrime(2 * p)
@@ -1169,72 +1659,70 @@ struct prime_number_hash_policy {
             5746614499066534157llu, 7240280573005008577llu, 9122181901073924329llu,
             11493228998133068689llu, 14480561146010017169llu, 18446744073709551557llu
         };
-        static constexpr size_t (* const mod_functions[])(size_t) =
-        {
-            &mod0, &mod2, &mod3, &mod5, &mod7, &mod11, &mod13, &mod17, &mod23, &mod29, &mod37,
-            &mod47, &mod59, &mod73, &mod97, &mod127, &mod151, &mod197, &mod251, &mod313, &mod397,
-            &mod499, &mod631, &mod797, &mod1009, &mod1259, &mod1597, &mod2011, &mod2539, &mod3203,
-            &mod4027, &mod5087, &mod6421, &mod8089, &mod10193, &mod12853, &mod16193, &mod20399,
-            &mod25717, &mod32401, &mod40823, &mod51437, &mod64811, &mod81649, &mod102877,
-            &mod129607, &mod163307, &mod205759, &mod259229, &mod326617, &mod411527, &mod518509,
-            &mod653267, &mod823117, &mod1037059, &mod1306601, &mod1646237, &mod2074129,
-            &mod2613229, &mod3292489, &mod4148279, &mod5226491, &mod6584983, &mod8296553,
-            &mod10453007, &mod13169977, &mod16593127, &mod20906033, &mod26339969, &mod33186281,
-            &mod41812097, &mod52679969, &mod66372617, &mod83624237, &mod105359939, &mod132745199,
-            &mod167248483, &mod210719881, &mod265490441, &mod334496971, &mod421439783,
-            &mod530980861, &mod668993977, &mod842879579, &mod1061961721, &mod1337987929,
-            &mod1685759167, &mod2123923447, &mod2675975881, &mod3371518343, &mod4247846927,
-            &mod5351951779, &mod6743036717, &mod8495693897, &mod10703903591, &mod13486073473,
-            &mod16991387857, &mod21407807219, &mod26972146961, &mod33982775741, &mod42815614441,
-            &mod53944293929, &mod67965551447, &mod85631228929, &mod107888587883, &mod135931102921,
-            &mod171262457903, &mod215777175787, &mod271862205833, &mod342524915839,
-            &mod431554351609, &mod543724411781, &mod685049831731, &mod863108703229,
-            &mod1087448823553, &mod1370099663459, &mod1726217406467, &mod2174897647073,
-            &mod2740199326961, &mod3452434812973, &mod4349795294267, &mod5480398654009,
-            &mod6904869625999, &mod8699590588571, &mod10960797308051, &mod13809739252051,
-            &mod17399181177241, &mod21921594616111, &mod27619478504183, &mod34798362354533,
-            &mod43843189232363, &mod55238957008387, &mod69596724709081, &mod87686378464759,
-            &mod110477914016779, &mod139193449418173, &mod175372756929481, &mod220955828033581,
-            &mod278386898836457, &mod350745513859007, &mod441911656067171, &mod556773797672909,
-            &mod701491027718027, &mod883823312134381, &mod1113547595345903, &mod1402982055436147,
-            &mod1767646624268779, &mod2227095190691797, &mod2805964110872297, &mod3535293248537579,
-            &mod4454190381383713, &mod5611928221744609, &mod7070586497075177, &mod8908380762767489,
-            &mod11223856443489329, &mod14141172994150357, &mod17816761525534927,
-            &mod22447712886978529, &mod28282345988300791, &mod35633523051069991,
-            &mod44895425773957261, &mod56564691976601587, &mod71267046102139967,
-            &mod89790851547914507, &mod113129383953203213, &mod142534092204280003,
-            &mod179581703095829107, &mod226258767906406483, &mod285068184408560057,
-            &mod359163406191658253, &mod452517535812813007, &mod570136368817120201,
-            &mod718326812383316683, &mod905035071625626043, &mod1140272737634240411,
-            &mod1436653624766633509, &mod1810070143251252131, &mod2280545475268481167,
-            &mod2873307249533267101, &mod3620140286502504283, &mod4561090950536962147,
-            &mod5746614499066534157, &mod7240280573005008577, &mod9122181901073924329,
-            &mod11493228998133068689, &mod14480561146010017169, &mod18446744073709551557
-        };
 
         const size_t* found = std::lower_bound(std::begin(prime_list), std::end(prime_list) - 1, size);
         size = *found;
-        return mod_functions[1 + found - prime_list];
+        return make_divisor(*found);
     }
 
-    void commit(mod_function new_mod_function) {
-        _current_mod_function = new_mod_function;
+    void commit(const prime_divisor& new_divisor) {
+        _divisor = new_divisor;
     }
 
+    // like the fibonacci policy in its reset state this returns 0 or 1,
+    // both of which are inside the empty default table
     void reset() {
-        _current_mod_function = &mod0;
+        _divisor = make_divisor(2);
     }
 
     size_t index_for_hash(size_t hash, size_t /*num_slots_minus_one*/) const {
-        return _current_mod_function(hash);
+        return mod(hash);
     }
 
     size_t keep_in_range(size_t index, size_t num_slots_minus_one) const {
-        return index > num_slots_minus_one ? _current_mod_function(index) : index;
+        return index > num_slots_minus_one ? mod(index) : index;
+    }
+
+    size_t grow_size(size_t bucket_count) const {
+        return std::max(size_t(4), 2 * bucket_count);
     }
 
 private:
-    mod_function _current_mod_function = &mod0;
+    prime_divisor _divisor = make_divisor(2);
+
+    size_t mod(size_t hash) const {
+        uint64_t quotient = ddaof::mul_high(hash, _divisor.magic);
+        quotient = (((hash - quotient) >> 1) + quotient) >> _divisor.shift;
+        return hash - quotient * _divisor.prime;
+    }
+
+    // only runs on rehash, so the 128 by 64 bit division is a plain shift-subtract loop
+    static prime_divisor make_divisor(size_t prime) {
+        int8_t floor_log2 = ddaof::log2(prime);
+        if ((prime & (prime - 1)) == 0) {
+            return { prime, 0, static_cast<int8_t>(floor_log2 - 1) };
+        }
+
+        // 2^(64 + floor_log2) / prime, the quotient fits in 64 bits because prime > 2^floor_log2
+        uint64_t quotient = 0;
+        uint64_t remainder = 0;
+        for (int bit = 64 + floor_log2; bit >= 0; --bit) {
+            bool carry = (remainder >> 63) != 0;
+            remainder = (remainder << 1) | (bit == 64 + floor_log2 ? 1 : 0);
+            quotient <<= 1;
+            if (carry || remainder >= prime) {
+                remainder -= prime;
+                quotient |= 1;
+            }
+        }
+
+        uint64_t magic = quotient + quotient;
+        uint64_t twice_remainder = remainder + remainder;
+        if (twice_remainder >= prime || twice_remainder < remainder) {
+            magic += 1;
+        }
+        return { prime, magic + 1, floor_log2 };
+    }
 };
 
 struct power_of_two_hash_policy {
@@ -1251,6 +1739,10 @@ struct power_of_two_hash_policy {
         return 0;
     }
 
+    size_t grow_size(size_t bucket_count) const {
+        return std::max(size_t(4), 2 * bucket_count);
+    }
+
     void commit(int8_t) {}
     void reset() {}
 };
@@ -1270,6 +1762,10 @@ struct fibonacci_hash_policy {
         return 64 - ddaof::log2(size);
     }
 
+    size_t grow_size(size_t bucket_count) const {
+        return std::max(size_t(4), 2 * bucket_count);
+    }
+
     void commit(int8_t shift) {
         this->shift = shift;
     }
@@ -1281,6 +1777,41 @@ private:
     int8_t shift = 63;
 };
 
+/**
+ * Lemire's fastrange: maps a hash onto [0, num_slots) with one multiply-high instead of a modulo,
+ * so the table can have any number of buckets.
+ * fastrange only looks at the high bits, so the hash is pre-mixed with the fibonacci multiplier first,
+ * otherwise small integer keys with an identity hash would all land in slot 0.
+ * The table grows by GrowthNumerator / GrowthDenominator (1.5x by default, 5/4 for 1.25x) instead of 2x.
+*/
+template<size_t GrowthNumerator = 3, size_t GrowthDenominator = 2>
+struct fastrange_hash_policy {
+    static_assert(GrowthNumerator > GrowthDenominator && GrowthDenominator > 0, "the growth factor has to be above 1");
+
+    size_t index_for_hash(size_t hash, size_t num_slots_minus_one) const {
+        return ddaof::mul_high(11400714819323198485ull * hash, num_slots_minus_one + 1);
+    }
+
+    size_t keep_in_range(size_t index, size_t num_slots_minus_one) const {
+        return index > num_slots_minus_one ? index - (num_slots_minus_one + 1) : index;
+    }
+
+    // any size works, nothing to round and nothing to commit
+    int8_t next_size_over(size_t& size) const {
+        size = std::max(size_t(2), size);
+        return 0;
+    }
+
+    size_t grow_size(size_t bucket_count) const {
+        size_t grown = bucket_count / GrowthDenominator * GrowthNumerator
+                + bucket_count % GrowthDenominator * GrowthNumerator / GrowthDenominator;
+        return std::max(size_t(4), std::max(grown, bucket_count + 1));
+    }
+
+    void commit(int8_t) {}
+    void reset() {}
+};
+
 template<typename K, typename V, typename H = std::hash<K>, typename E = std::equal_to<K>, typename A = std::allocator<std::pair<K, V> > >
 class flat_hash_map
         : public ddaof::faster_hashtable <
@@ -0,0 +1,745 @@
+#pragma once
+
+#include <stdexcept>
+#include <vector>
+
+#include "faster_hashtable.hpp"
+
+namespace ddaof {
+
+/**
+ * An extendible-hashing table built on top of faster_table_entry.
+ * The directory maps the high bits of the (fibonacci mixed) hash to fixed-size segments,
+ * and every segment is a small robin-hood table with the same layout as faster_hashtable:
+ * SegmentSize slots, max_lookups - 1 overflow slots, and one special end item.
+ * Growth splits exactly one segment at a time, so there is never a full-table copy,
+ * and the biggest allocation is a single segment (the directory only holds pointers).
+*/
+template <typename T, typename FindKey,
+          typename ArgumentHash, typename Hasher,
+          typename ArgumentEqual, typename Equal,
+          typename ArgumentAlloc, typename EntryAlloc,
+          size_t SegmentSize>
+class linear_hashtable : private EntryAlloc, private Hasher, private Equal {
+    using Entry = faster_table_entry<T>;
+    using AllocatorTraits = std::allocator_traits<EntryAlloc>;
+    using EntryPointer = typename AllocatorTraits::pointer;
+
+    struct segment {
+        EntryPointer entries;
+        size_t num_elements;
+        size_t position; // index in _segments
+        size_t prefix;   // the local_depth directory bits shared by every key of the segment
+        int8_t local_depth;
+    };
+
+    using SegmentAlloc = typename AllocatorTraits::template rebind_alloc<segment>;
+    using SegmentAllocTraits = std::allocator_traits<SegmentAlloc>;
+    using SegmentPointerAlloc = typename AllocatorTraits::template rebind_alloc<segment*>;
+    using Directory = std::vector<segment*, SegmentPointerAlloc>;
+
+    static constexpr int8_t constexpr_log2(size_t value) {
+        return value <= 1 ? 0 : 1 + constexpr_log2(value >> 1);
+    }
+
+    static_assert(SegmentSize >= 8 && (SegmentSize & (SegmentSize - 1)) == 0, "SegmentSize must be a power of two and at least 8");
+
+    static constexpr int8_t segment_bits = constexpr_log2(SegmentSize);
+    // a segment is never resized, so it can afford a longer probe bound than a whole table
+    static constexpr int8_t max_lookups = segment_bits * 2 < min_lookups ? min_lookups : segment_bits * 2;
+    static constexpr size_t slots_per_segment = SegmentSize + max_lookups;
+    static constexpr int8_t max_depth = 64 - segment_bits;
+    // the directory may grow to 2^max_directory_slack entries per segment, only keys that share
+    // their hash bits split that unevenly, and splitting again would not separate them
+    static constexpr int8_t max_directory_slack = 8;
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using hasher = ArgumentHash;
+    using key_equal = ArgumentEqual;
+    using allocator_type = EntryAlloc;
+
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+
+    linear_hashtable() {}
+
+    explicit linear_hashtable(size_type bucket_count,
+                              const ArgumentHash& hash = ArgumentHash(),
+                              const ArgumentEqual& equal = ArgumentEqual(),
+                              const ArgumentAlloc& alloc = ArgumentAlloc())
+            : EntryAlloc(alloc), Hasher(hash), Equal(equal), _directory(SegmentPointerAlloc(alloc)),
+              _segments(SegmentPointerAlloc(alloc)) {
+        reserve(static_cast<size_t>(bucket_count * static_cast<double>(_max_load_factor)));
+    }
+
+    explicit linear_hashtable(const ArgumentAlloc& alloc)
+            : EntryAlloc(alloc), _directory(SegmentPointerAlloc(alloc)), _segments(SegmentPointerAlloc(alloc)) {}
+
+    template<typename It>
+    linear_hashtable(It first, It last, size_type bucket_count = 0,
+                     const ArgumentHash& hash = ArgumentHash(),
+                     const ArgumentEqual& equal = ArgumentEqual(),
+                     const ArgumentAlloc& alloc = ArgumentAlloc())
+            : linear_hashtable(bucket_count, hash, equal, alloc) {
+        insert(first, last);
+    }
+
+    linear_hashtable(std::initializer_list<T> initializer_list,
+                     size_type bucket_count = 0,
+                     const ArgumentHash& hash = ArgumentHash(),
+                     const ArgumentEqual& equal = ArgumentEqual(),
+                     const ArgumentAlloc& alloc = ArgumentAlloc())
+            : linear_hashtable(bucket_count, hash, equal, alloc) {
+        insert(initializer_list.begin(), initializer_list.end());
+    }
+
+    linear_hashtable(const linear_hashtable& other)
+            : EntryAlloc(AllocatorTraits::select_on_container_copy_construction(other.get_allocator())),
+              Hasher(other), Equal(other), _max_load_factor(other._max_load_factor) {
+        try {
+            insert(other.begin(), other.end());
+        } catch(...) {
+            reset_to_empty_state();
+            throw;
+        }
+    }
+
+    linear_hashtable(linear_hashtable&& other) noexcept
+            : EntryAlloc(std::move(other)), Hasher(std::move(other)), Equal(std::move(other)) {
+        swap_pointers(other);
+    }
+
+    linear_hashtable& operator=(const linear_hashtable& other) {
+        if (this == std::addressof(other)) {
+            return *this;
+        }
+
+        clear();
+        _max_load_factor = other._max_load_factor;
+        static_cast<Hasher&>(*this) = other;
+        static_cast<Equal&>(*this) = other;
+        insert(other.begin(), other.end());
+        return *this;
+    }
+
+    linear_hashtable& operator=(linear_hashtable&& other) noexcept {
+        if (this != std::addressof(other)) {
+            reset_to_empty_state();
+            swap_pointers(other);
+            static_cast<Hasher&>(*this) = std::move(other);
+            static_cast<Equal&>(*this) = std::move(other);
+        }
+        return *this;
+    }
+
+    ~linear_hashtable() {
+        reset_to_empty_state();
+    }
+
+    const allocator_type& get_allocator() const {
+        return static_cast<const allocator_type&>(*this);
+    }
+
+    const ArgumentEqual& key_eq() const {
+        return static_cast<const ArgumentEqual&>(*this);
+    }
+
+    const ArgumentHash& hash_function() const {
+        return static_cast<const ArgumentHash&>(*this);
+    }
+
+    template<typename ValueType>
+    struct templated_iterator {
+        templated_iterator() = default;
+        templated_iterator(segment* const* current_segment, segment* const* last_segment, EntryPointer current)
+                : current_segment(current_segment), last_segment(last_segment), current(current) {}
+
+        segment* const* current_segment = nullptr;
+        segment* const* last_segment = nullptr;
+        EntryPointer current = EntryPointer();
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ValueType;
+        using difference_type = ptrdiff_t;
+        using pointer = ValueType*;
+        using reference = ValueType&;
+
+        friend bool operator==(const templated_iterator& lhs, const templated_iterator& rhs) {
+            return lhs.current == rhs.current;
+        }
+        friend bool operator!=(const templated_iterator& lhs, const templated_iterator& rhs) {
+            return !(lhs == rhs);
+        }
+
+        templated_iterator& operator++() {
+            // the special end item of every segment stops the inner loop
+            do {
+                ++current;
+            } while (current->is_empty());
+            if (current == (*current_segment)->entries + static_cast<ptrdiff_t>(slots_per_segment - 1)) {
+                skip_to_next_segment();
+            }
+            return *this;
+        }
+
+        templated_iterator operator++(int) {
+            templated_iterator copy(*this);
+            ++*this;
+            return copy;
+        }
+
+        ValueType& operator*() const {
+            return current->_value;
+        }
+
+        ValueType* operator->() const {
+            return std::addressof(current->_value);
+        }
+
+        operator templated_iterator<const value_type>() const {
+            return { current_segment, last_segment, current };
+        }
+
+        // move to the first value of the next non-empty segment, or become end()
+        void skip_to_next_segment() {
+            seek_from(current_segment + 1);
+        }
+
+        // move to the first value of the first non-empty segment from seg on, or become end()
+        void seek_from(segment* const* seg) {
+            for (current_segment = seg; current_segment != last_segment; ++current_segment) {
+                if ((*current_segment)->num_elements) {
+                    current = (*current_segment)->entries;
+                    while (current->is_empty()) {
+                        ++current;
+                    }
+                    return;
+                }
+            }
+            current = EntryPointer();
+        }
+    };
+
+    using iterator = templated_iterator<value_type>;
+    using const_iterator = templated_iterator<const value_type>;
+
+    iterator begin() {
+        segment* const* first = _segments.data();
+        segment* const* last = first + _segments.size();
+        iterator result(first, last, EntryPointer());
+        result.seek_from(first);
+        return result;
+    }
+
+    const_iterator begin() const {
+        return const_cast<linear_hashtable*>(this)->begin();
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    iterator end() {
+        segment* const* last = _segments.data() + _segments.size();
+        return { last, last, EntryPointer() };
+    }
+
+    const_iterator end() const {
+        return const_cast<linear_hashtable*>(this)->end();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    iterator find(const FindKey& key) {
+        if (_directory.empty()) {
+            return end();
+        }
+        size_t mixed = mix(hash_object(key));
+        segment* const* seg = std::addressof(_directory[directory_index(mixed)]);
+        EntryPointer it = (*seg)->entries + static_cast<ptrdiff_t>(slot_index(mixed));
+        for (int8_t distance = 0; it->_distance_from_desired >= distance; ++distance, ++it) {
+            if (compares_equal(key, it->_value)) {
+                return make_iterator(*seg, it);
+            }
+        }
+        return end();
+    }
+
+    const_iterator find(const FindKey& key) const {
+        return const_cast<linear_hashtable*>(this)->find(key);
+    }
+
+    size_t count(const FindKey& key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    template<typename Key, typename ...Args>
+    std::pair<iterator, bool> emplace(Key&& key, Args&& ...args) {
+        if (_directory.empty()) {
+            initialize();
+        }
+
+        size_t mixed = mix(hash_object(key));
+        segment* seg = _directory[directory_index(mixed)];
+        EntryPointer current_entry = seg->entries + static_cast<ptrdiff_t>(slot_index(mixed));
+        int8_t distance_from_desired = 0;
+        for (; current_entry->_distance_from_desired >= distance_from_desired; ++current_entry, ++distance_from_desired) {
+            if (compares_equal(key, current_entry->_value)) {
+                return std::make_pair(make_iterator(seg, current_entry), false);
+            }
+        }
+
+        return emplace_new_key(seg, distance_from_desired, current_entry, std::forward<Key>(key), std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    iterator emplace_hint(const_iterator, Args&& ...args) {
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return emplace(value);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return emplace(std::move(value));
+    }
+
+    template<typename It>
+    void insert(It begin, It end) {
+        for (; begin != end; ++begin) {
+            emplace(*begin);
+        }
+    }
+
+    void insert(std::initializer_list<value_type> initializer_list) {
+        insert(initializer_list.begin(), initializer_list.end());
+    }
+
+    // only ever splits, one segment at a time, until every segment is below the load factor
+    void reserve(size_t num_elements) {
+        if (num_elements == 0) {
+            return;
+        }
+        if (_directory.empty()) {
+            initialize();
+        }
+        size_t per_segment = std::max(size_t(1), static_cast<size_t>(SegmentSize * static_cast<double>(_max_load_factor)));
+        size_t wanted_segments = (num_elements + per_segment - 1) / per_segment;
+        while (_segments.size() < wanted_segments) {
+            // split the shallowest level first, split() keeps the position of the lower half
+            int8_t depth = max_depth;
+            for (segment* seg : _segments) {
+                depth = std::min(depth, seg->local_depth);
+            }
+            if (depth == max_depth) {
+                return;
+            }
+            for (size_t i = 0, num_segments = _segments.size(); i < num_segments && _segments.size() < wanted_segments; ++i) {
+                if (_segments[i]->local_depth == depth) {
+                    split(_segments[i]);
+                }
+            }
+        }
+    }
+
+    void erase(const_iterator to_erase) {
+        segment* seg = *to_erase.current_segment;
+        EntryPointer current = to_erase.current;
+        current->destroy_value();
+        --seg->num_elements;
+        --_num_elements;
+
+        for (EntryPointer next = current + ptrdiff_t(1); !next->is_at_desired_position(); ++current, ++next) {
+            current->emplace(next->_distance_from_desired - 1, std::move(next->_value));
+            next->destroy_value();
+        }
+    }
+
+    size_t erase(const FindKey& key) {
+        auto found = find(key);
+        if (found == end()) {
+            return 0;
+        } else {
+            erase(found);
+            return 1;
+        }
+    }
+
+    // keeps the segments, like faster_hashtable::clear keeps its buckets
+    void clear() {
+        for (segment* seg : _segments) {
+            destroy_values(seg);
+        }
+        _num_elements = 0;
+    }
+
+    void swap(linear_hashtable& other) {
+        using std::swap;
+        swap_pointers(other);
+        swap(static_cast<ArgumentHash&>(*this), static_cast<ArgumentHash&>(other));
+        swap(static_cast<ArgumentEqual&>(*this), static_cast<ArgumentEqual&>(other));
+        if (AllocatorTraits::propagate_on_container_swap::value) {
+            swap(static_cast<EntryAlloc&>(*this), static_cast<EntryAlloc&>(other));
+        }
+    }
+
+    size_t size() const {
+        return _num_elements;
+    }
+
+    bool empty() const {
+        return _num_elements == 0;
+    }
+
+    size_t bucket_count() const {
+        return _segments.size() * SegmentSize;
+    }
+
+    size_t segment_count() const {
+        return _segments.size();
+    }
+
+    static constexpr size_t segment_size() {
+        return SegmentSize;
+    }
+
+    float load_factor() const {
+        size_t buckets = bucket_count();
+        if (buckets) {
+            return static_cast<float>(_num_elements) / buckets;
+        } else {
+            return 0;
+        }
+    }
+
+    void max_load_factor(float value) {
+        _max_load_factor = value;
+    }
+
+    float max_load_factor() const {
+        return _max_load_factor;
+    }
+
+    // bytes of the directory, the segment headers and their slots
+    size_t memory_usage() const {
+        return (_directory.capacity() + _segments.capacity()) * sizeof(segment*)
+             + _segments.size() * (sizeof(segment) + slots_per_segment * sizeof(Entry));
+    }
+
+    // memory_usage() plus the heap memory owned by the elements, see owned_heap_bytes, O(size())
+    size_t deep_memory_usage() const {
+        size_t result = memory_usage();
+        for (const T& value : *this) {
+            result += owned_heap_bytes_of(value);
+        }
+        return result;
+    }
+
+private:
+    Directory _directory;
+    Directory _segments; // every segment exactly once, in creation order
+    int8_t _global_depth = 0;
+    float _max_load_factor = 0.5f;
+    size_t _num_elements = 0;
+
+    static size_t mix(size_t hash) {
+        return 11400714819323198485ull * hash;
+    }
+
+    // the top segment_bits pick the slot, the next _global_depth bits pick the directory entry
+    static size_t slot_index(size_t mixed) {
+        return mixed >> (64 - segment_bits);
+    }
+
+    size_t directory_index(size_t mixed) const {
+        return _global_depth ? (mixed << segment_bits) >> (64 - _global_depth) : 0;
+    }
+
+    iterator make_iterator(segment* seg, EntryPointer it) {
+        segment* const* first = _segments.data();
+        return { first + static_cast<ptrdiff_t>(seg->position), first + _segments.size(), it };
+    }
+
+    template<typename Key, typename... Args>
+    DDAOF_NOINLINE(std::pair<iterator, bool>)
+    emplace_new_key(segment* seg, int8_t distance_from_desired, EntryPointer current_entry, Key&& key, Args&&... args) {
+        using std::swap;
+        if (distance_from_desired == max_lookups
+                || seg->num_elements + 1 > SegmentSize * static_cast<double>(_max_load_factor)
+                || displaced_chain_overflows(distance_from_desired, current_entry)) {
+            split(seg);
+            return emplace(std::forward<Key>(key), std::forward<Args>(args)...);
+        } else if (current_entry->is_empty()) {
+            current_entry->emplace(distance_from_desired, std::forward<Key>(key), std::forward<Args>(args)...);
+            ++seg->num_elements;
+            ++_num_elements;
+            return std::make_pair(make_iterator(seg, current_entry), true);
+        } else {/*Nothing need to do*/}
+
+        value_type to_insert(std::forward<Key>(key), std::forward<Args>(args)...);
+        swap(distance_from_desired, current_entry->_distance_from_desired);
+        swap(to_insert, current_entry->_value);
+        EntryPointer result = current_entry;
+
+        for (++distance_from_desired, ++current_entry;; ++current_entry) {
+            if (current_entry->is_empty()) {
+                current_entry->emplace(distance_from_desired, std::move(to_insert));
+                ++seg->num_elements;
+                ++_num_elements;
+                return std::make_pair(make_iterator(seg, result), true);
+            } else if (current_entry->_distance_from_desired < distance_from_desired) {
+                swap(distance_from_desired, current_entry->_distance_from_desired);
+                swap(to_insert, current_entry->_value);
+            }
+            ++distance_from_desired;
+        }
+    }
+
+    // whether the values displaced by an insert at current_entry would run past max_lookups,
+    // checked before anything moves so that a split (which can throw) starts from an intact segment
+    static bool displaced_chain_overflows(int8_t distance_from_desired, EntryPointer current_entry) {
+        for (; !current_entry->is_empty(); ++current_entry) {
+            distance_from_desired = current_entry->_distance_from_desired < distance_from_desired
+                                    ? current_entry->_distance_from_desired + 1 : distance_from_desired + 1;
+            if (distance_from_desired == max_lookups) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // move a value that is known to be new into a segment that is being filled by split(),
+    // the halves only hold a subset of the old keys at the same desired slots, so this never
+    // runs into the special end item in practice
+    void place_for_split(segment* seg, value_type&& value) {
+        using std::swap;
+        value_type to_insert(std::move(value));
+        EntryPointer special_end_item = seg->entries + static_cast<ptrdiff_t>(slots_per_segment - 1);
+        EntryPointer current_entry = seg->entries + static_cast<ptrdiff_t>(slot_index(mix(hash_object(to_insert))));
+        for (int8_t distance_from_desired = 0; current_entry != special_end_item; ++current_entry, ++distance_from_desired) {
+            if (current_entry->is_empty()) {
+                current_entry->emplace(distance_from_desired, std::move(to_insert));
+                ++seg->num_elements;
+                return;
+            } else if (current_entry->_distance_from_desired < distance_from_desired) {
+                swap(distance_from_desired, current_entry->_distance_from_desired);
+                swap(to_insert, current_entry->_value);
+            }
+        }
+        throw std::length_error("Segment overflow while splitting linear_hashtable.");
+    }
+
+    void split(segment* seg) {
+        if (seg->local_depth == max_depth
+                || (seg->local_depth == _global_depth && (size_t(1) << _global_depth) >= (_segments.size() << max_directory_slack))) {
+            throw std::length_error("Too many keys share the same hash value in linear_hashtable.");
+        }
+        if (seg->local_depth == _global_depth) {
+            double_directory();
+        }
+
+        // step1 allocate the two halves, the old segment stays intact until every value has moved
+        int8_t depth = seg->local_depth + 1;
+        segment* low = allocate_segment(depth, seg->prefix << 1, seg->position);
+        segment* high;
+        try {
+            high = allocate_segment(depth, (seg->prefix << 1) | 1, _segments.size());
+            _segments.push_back(high);
+        } catch(...) {
+            deallocate_segment(low);
+            throw;
+        }
+
+        // step2 redistribute by the first hash bit the old segment did not look at
+        int8_t bit = 63 - segment_bits - seg->local_depth;
+        for (EntryPointer it = seg->entries, end = it + static_cast<ptrdiff_t>(slots_per_segment - 1); it != end; ++it) {
+            if (it->has_value()) {
+                segment* target = (mix(hash_object(it->_value)) >> bit) & 1 ? high : low;
+                place_for_split(target, std::move(it->_value));
+                it->destroy_value();
+            }
+        }
+
+        // step3 point the directory range of the old segment at the two halves
+        size_t half = size_t(1) << (_global_depth - depth);
+        auto first = _directory.begin() + static_cast<ptrdiff_t>(seg->prefix << (_global_depth - seg->local_depth));
+        std::fill(first, first + half, low);
+        std::fill(first + half, first + 2 * half, high);
+
+        _segments[seg->position] = low;
+        deallocate_segment(seg);
+    }
+
+    void double_directory() {
+        Directory doubled(_directory.size() * 2, nullptr, _directory.get_allocator());
+        for (size_t i = 0; i < _directory.size(); ++i) {
+            doubled[2 * i] = _directory[i];
+            doubled[2 * i + 1] = _directory[i];
+        }
+        _directory.swap(doubled);
+        ++_global_depth;
+    }
+
+    void initialize() {
+        _directory.push_back(allocate_segment(0, 0, 0));
+        _segments.push_back(_directory.front());
+        _global_depth = 0;
+    }
+
+    segment* allocate_segment(int8_t local_depth, size_t prefix, size_t position) {
+        SegmentAlloc segment_alloc(static_cast<const EntryAlloc&>(*this));
+        segment* result = SegmentAllocTraits::allocate(segment_alloc, 1);
+        try {
+            result->entries = AllocatorTraits::allocate(*this, slots_per_segment);
+        } catch(...) {
+            SegmentAllocTraits::deallocate(segment_alloc, result, 1);
+            throw;
+        }
+        result->num_elements = 0;
+        result->position = position;
+        result->prefix = prefix;
+        result->local_depth = local_depth;
+
+        EntryPointer special_end_item = result->entries + static_cast<ptrdiff_t>(slots_per_segment - 1);
+        for (EntryPointer it = result->entries; it != special_end_item; ++it) {
+            it->_distance_from_desired = -1;
+        }
+        special_end_item->_distance_from_desired = Entry::_special_end_value;
+        return result;
+    }
+
+    void deallocate_segment(segment* seg) {
+        AllocatorTraits::deallocate(*this, seg->entries, slots_per_segment);
+        SegmentAlloc segment_alloc(static_cast<const EntryAlloc&>(*this));
+        SegmentAllocTraits::deallocate(segment_alloc, seg, 1);
+    }
+
+    void destroy_values(segment* seg) {
+        for (EntryPointer it = seg->entries, end = it + static_cast<ptrdiff_t>(slots_per_segment - 1); it != end; ++it) {
+            if (it->has_value()) {
+                it->destroy_value();
+            }
+        }
+        seg->num_elements = 0;
+    }
+
+    void reset_to_empty_state() {
+        for (segment* seg : _segments) {
+            destroy_values(seg);
+            deallocate_segment(seg);
+        }
+        _segments.clear();
+        _directory.clear();
+        _global_depth = 0;
+        _num_elements = 0;
+    }
+
+    void swap_pointers(linear_hashtable& other) {
+        using std::swap;
+        _directory.swap(other._directory);
+        _segments.swap(other._segments);
+        swap(_global_depth, other._global_depth);
+        swap(_num_elements, other._num_elements);
+        swap(_max_load_factor, other._max_load_factor);
+    }
+
+    template<typename U>
+    size_t hash_object(const U& key) {
+        return static_cast<Hasher&>(*this)(key);
+    }
+
+    template<typename L, typename R>
+    bool compares_equal(const L& lhs, const R& rhs) {
+        return static_cast<Equal&>(*this)(lhs, rhs);
+    }
+};
+
+template<typename K, typename V, typename H = std::hash<K>, typename E = std::equal_to<K>,
+         typename A = std::allocator<std::pair<K, V> >, size_t SegmentSize = 512>
+class linear_hash_map
+        : public ddaof::linear_hashtable <
+            std::pair<K, V>,
+            K,
+            H,
+            ddaof::KeyOrValueHasher<K, std::pair<K, V>, H>,
+            E,
+            ddaof::KeyOrValueEquality<K, std::pair<K, V>, E>,
+            A,
+            typename std::allocator_traits<A>::template rebind_alloc<ddaof::faster_table_entry<std::pair<K, V>>>,
+            SegmentSize> {
+    using Table = ddaof::linear_hashtable
+    <
+        std::pair<K, V>,
+        K,
+        H,
+        ddaof::KeyOrValueHasher<K, std::pair<K, V>, H>,
+        E,
+        ddaof::KeyOrValueEquality<K, std::pair<K, V>, E>,
+        A,
+        typename std::allocator_traits<A>::template rebind_alloc<ddaof::faster_table_entry<std::pair<K, V>>>,
+        SegmentSize
+    >;
+public:
+    using key_type = K;
+    using mapped_type = V;
+
+    using Table::Table;
+    linear_hash_map() {}
+
+    inline V& operator[](const K& key) {
+        return this->emplace(key, convertible_to_value()).first->second;
+    }
+
+    inline V& operator[](K&& key) {
+        return this->emplace(std::move(key), convertible_to_value()).first->second;
+    }
+
+    V& at(const K& key) {
+        auto found = this->find(key);
+        if (found == this->end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+    const V& at(const K& key) const {
+        auto found = this->find(key);
+        if (found == this->end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+    friend bool operator==(const linear_hash_map& lhs, const linear_hash_map& rhs) {
+        if (lhs.size() != rhs.size())
+            return false;
+        for (const typename Table::value_type& value : lhs) {
+            auto found = rhs.find(value.first);
+            if (found == rhs.end())
+                return false;
+            else if (value.second != found->second)
+                return false;
+        }
+        return true;
+    }
+
+    friend bool operator!=(const linear_hash_map& lhs, const linear_hash_map& rhs) {
+        return !(lhs == rhs);
+    }
+
+private:
+    struct convertible_to_value {
+        operator V() const {
+            return V();
+        }
+    };
+};
+
+} // end namespace ddaof
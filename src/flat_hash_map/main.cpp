@@ -1,86 +1,895 @@
-#include "new_faster_hashtable.hpp"  // 包含您的哈希表实现
-#include <unordered_map>
+// Benchmark matrix for the hash tables in this repository, written to stdout as JSON.
+//
+// --tables picks the tables to measure, every result carries the name of its table. faster_hashtable.hpp,
+// new_faster_hashtable.hpp and the one src/unordered_map builds on all define the same ddaof names, so
+// each build holds one family of them, plus std::unordered_map as the reference every JSON file shares:
+//
+//     g++ -O2 -std=c++17 main.cpp -o bench_faster                         # faster_hashtable, linear_hashtable
+//     g++ -O2 -std=c++17 -DBENCH_NEW_FASTER main.cpp -o bench_new_faster  # new_faster_hashtable
+//     g++ -O2 -std=c++17 -DBENCH_SHERWOOD main.cpp -o bench_sherwood      # sherwood_v10_table
+//     ./bench_faster --sizes=1000,1000000 --keys=uint64,string64 --reps=7 > faster.json
+//
+// Hash policies only apply to the open addressing tables; std::unordered_map and linear_hashtable,
+// which mixes its hashes itself, run once with the policy "default".
+//
+// Every configuration runs --warmup discarded repetitions and --reps measured ones and reports the
+// median, standard deviation and minimum in ns per operation. Keys and lookup sequences come from
+// fixed seeds, so two runs (or two binaries) see exactly the same operations.
+// Configurations whose data would not fit in --max-memory-mb are skipped with a note on stderr.
+//
+// --mode=latency times every operation on its own instead (every --sample-every'th one when
+// the timer overhead matters) and reports p50, p99, p99.9, p99.99 and max per operation from an
+// HDR-style histogram, which is where the stalls of a grow() show up:
+//
+//     ./bench_faster --mode=latency --sizes=8000000 --keys=uint64 --policies=fibonacci > tail.json
+//
+// On x86 the timer is rdtscp calibrated against steady_clock, elsewhere steady_clock itself.
+// The cost of one timer read pair is reported as timer_overhead_ns and is included in every sample.
+//
+// --mode=memory builds each table once through counting_allocator and reports the bytes it holds
+// when full, its peak while growing (the old and the new slot array are both alive during a rehash),
+// the number of allocations and bytes per element. The change in VmRSS and VmHWM from /proc/self/status
+// is reported next to them as a cross-check; it also includes the heap blocks of std::string keys,
+// which the table's allocator never sees, and is only meaningful for tables of a few MB or more.
+//
+// Not covered: ska::unordered_map in src/unordered_map needs a flat_hash_map.hpp that is not in the
+// repository, and string_with_hash keys are only built when city.h is on the include path.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <random>
-#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(BENCH_NEW_FASTER)
+#include "new_faster_hashtable.hpp"
+#elif defined(BENCH_SHERWOOD)
+#include "../unordered_map/new_unoreder_map.hpp"
+#else
+#include "linear_hashtable.hpp"
+#define BENCH_FASTRANGE 1
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#define BENCH_TIMER_NAME "rdtscp"
+#else
+#define BENCH_TIMER_NAME "steady_clock"
+#endif
+
+#if __has_include("city.h")
+#include "../string_hash/string_with_hash.hpp"
+#define BENCH_STRING_WITH_HASH 1
+#endif
+
+/**
+ * The tables a build can measure. name is what --tables takes and what the results report,
+ * map<K, V, H, A> is the table for keys K, values V, hasher H and an allocator A of value<K, V>,
+ * and has_policies says whether the table reads a hash_policy from its hasher.
+*/
+struct std_table {
+    static constexpr const char* name = "std::unordered_map";
+    static constexpr bool has_policies = false;
+    template<typename K, typename V>
+    using value = std::pair<const K, V>;
+    template<typename K, typename V, typename H, typename A>
+    using map = std::unordered_map<K, V, H, std::equal_to<K>, A>;
+};
+
+#if defined(BENCH_NEW_FASTER)
+struct new_faster_table {
+    static constexpr const char* name = "new_faster_hashtable";
+    static constexpr bool has_policies = true;
+    template<typename K, typename V>
+    using value = std::pair<K, V>;
+    template<typename K, typename V, typename H, typename A>
+    using map = ddaof::flat_hash_map<K, V, H, std::equal_to<K>, A>;
+};
+#elif defined(BENCH_SHERWOOD)
+struct sherwood_table {
+    static constexpr const char* name = "sherwood_v10_table";
+    static constexpr bool has_policies = true;
+    template<typename K, typename V>
+    using value = std::pair<K, V>;
+    template<typename K, typename V, typename H, typename A>
+    using map = ddaof::unordered_map<K, V, H, std::equal_to<K>, A>;
+};
+#else
+struct faster_table {
+    static constexpr const char* name = "faster_hashtable";
+    static constexpr bool has_policies = true;
+    template<typename K, typename V>
+    using value = std::pair<K, V>;
+    template<typename K, typename V, typename H, typename A>
+    using map = ddaof::flat_hash_map<K, V, H, std::equal_to<K>, A>;
+};
+
+struct linear_table {
+    static constexpr const char* name = "linear_hashtable";
+    static constexpr bool has_policies = false;
+    template<typename K, typename V>
+    using value = std::pair<K, V>;
+    template<typename K, typename V, typename H, typename A>
+    using map = ddaof::linear_hash_map<K, V, H, std::equal_to<K>, A>;
+};
+#endif
+
+template<typename... Tables>
+struct table_list {};
+
+#if defined(BENCH_NEW_FASTER)
+using bench_tables = table_list<new_faster_table, std_table>;
+#elif defined(BENCH_SHERWOOD)
+using bench_tables = table_list<sherwood_table, std_table>;
+#else
+using bench_tables = table_list<faster_table, linear_table, std_table>;
+#endif
+
+template<typename... Tables>
+std::vector<std::string> table_names(table_list<Tables...>) {
+    return { Tables::name... };
+}
+
+template<typename Table, typename K, typename H, typename A = std::allocator<typename Table::template value<K, uint32_t>>>
+using bench_map = typename Table::template map<K, uint32_t, H, A>;
+
+using bench_clock = std::chrono::steady_clock;
+
+struct bench_config {
+    std::vector<std::string> tables = table_names(bench_tables());
+    std::vector<size_t> sizes = { 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+    std::vector<std::string> keys = { "int", "uint64", "string64", "string_with_hash" };
+    std::vector<std::string> policies = { "fibonacci", "power_of_two", "prime", "fastrange" };
+    std::vector<double> hit_ratios = { 1.0, 0.5, 0.0 };
+    std::vector<double> load_factors = { 0.5, 0.875 };
+    size_t warmup = 1;
+    size_t reps = 5;
+    size_t min_lookups = 1 << 20; // small maps are looked up more often than they have keys, to get past timer noise
+    size_t max_memory_mb = 8192;
+    uint64_t seed = 0x5eed5eed;
+    std::string mode = "throughput"; // or "latency" or "memory"
+    size_t sample_every = 1; // latency mode only
+};
+
+struct sample_stats {
+    double median;
+    double stddev;
+    double min;
+};
+
+// everything a measured loop finds ends up here, so the loops cannot be optimized away
+volatile uint64_t g_sink = 0;
+
+struct allocation_stats {
+    size_t live_bytes = 0;
+    size_t peak_bytes = 0;
+    size_t allocations = 0;
+};
 
-// 定义您的哈希表类型，假设这是模板参数的一种可能实现
-using FasterHashTable = ddaof::flat_hash_map<int, int>;
+// what every counting_allocator has handed out, whatever it was rebound to
+allocation_stats g_allocations;
 
-// 测试参数
-const size_t TEST_SIZE = 8000000;  // 测试元素数量
-const int NUM_TESTS = 8;          // 测试次数
+template<typename T>
+struct counting_allocator {
+    typedef T value_type;
 
-// 生成随机数的函数
-std::vector<uint64_t> generate_random_data(size_t size) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<uint64_t> dis(1, 1000000);  // 生成 uint64_t 类型的随机数
+    counting_allocator() = default;
+
+    template<typename U>
+    counting_allocator(const counting_allocator<U>&) {}
+
+    T* allocate(size_t n) {
+        T* result = std::allocator<T>().allocate(n);
+        g_allocations.live_bytes += n * sizeof(T);
+        g_allocations.peak_bytes = std::max(g_allocations.peak_bytes, g_allocations.live_bytes);
+        ++g_allocations.allocations;
+        return result;
+    }
+
+    void deallocate(T* p, size_t n) {
+        g_allocations.live_bytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const counting_allocator<U>&) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const counting_allocator<U>&) const {
+        return false;
+    }
+};
+
+// a field of /proc/self/status in kB, 0 where there is no such file
+size_t read_status_kb(const std::string& field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size() + 1, field + ":") == 0) {
+            return std::strtoull(line.c_str() + field.size() + 1, nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+// writing 5 to clear_refs sets VmHWM back to the current VmRSS (Linux 4.0 and later)
+bool reset_peak_rss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    return static_cast<bool>(clear_refs << "5" << std::flush);
+}
+
+// bijections, so distinct indices always give distinct keys
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+uint32_t mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    return x ^ (x >> 16);
+}
 
-    std::vector<uint64_t> data(size);
-    for (auto& elem : data) {
-        elem = dis(gen);
+// the layout of src/random_string_generator.cpp: 7-byte prefix, 49 variable bytes, 8-byte suffix
+std::string make_string64(uint64_t index, uint64_t seed) {
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    std::string result = "AAACPGC";
+    uint64_t unique = mix64(index ^ seed);
+    for (int i = 0; i < 11; ++i) { // 62^11 > 2^64, so the digits alone keep the keys distinct
+        result += chars[unique % 62];
+        unique /= 62;
+    }
+    uint64_t filler = mix64(index + seed);
+    for (int i = 0; i < 38; ++i) {
+        filler = mix64(filler);
+        result += chars[filler % 62];
+    }
+    return result + "VVQTYPXX";
+}
+
+template<typename K>
+struct key_maker;
+
+template<>
+struct key_maker<int> {
+    static constexpr size_t bytes_per_key = sizeof(int);
+    static int make(uint64_t index, uint64_t seed) {
+        return static_cast<int>(mix32(static_cast<uint32_t>(index) ^ static_cast<uint32_t>(seed)));
+    }
+};
+
+template<>
+struct key_maker<uint64_t> {
+    static constexpr size_t bytes_per_key = sizeof(uint64_t);
+    static uint64_t make(uint64_t index, uint64_t seed) {
+        return mix64(index ^ seed);
+    }
+};
+
+template<>
+struct key_maker<std::string> {
+    static constexpr size_t bytes_per_key = sizeof(std::string) + 80;
+    static std::string make(uint64_t index, uint64_t seed) {
+        return make_string64(index, seed);
+    }
+};
+
+#ifdef BENCH_STRING_WITH_HASH
+struct string_with_hash_hasher {
+    size_t operator()(const ddaof::string_with_hash& key) const {
+        return key.hash();
+    }
+};
+
+template<>
+struct key_maker<ddaof::string_with_hash> {
+    static constexpr size_t bytes_per_key = sizeof(ddaof::string_with_hash) + 80;
+    static ddaof::string_with_hash make(uint64_t index, uint64_t seed) {
+        std::string str = make_string64(index, seed);
+        return ddaof::string_with_hash(str);
+    }
+};
+#endif
+
+// the hasher H with one of the table's hash policies declared on it
+template<typename H, typename Policy>
+struct policy_hash : H {
+    typedef Policy hash_policy;
+};
+
+template<typename K>
+struct bench_data {
+    std::vector<K> present;
+    std::vector<K> absent;
+    std::vector<uint32_t> erase_order;
+    std::vector<std::vector<uint32_t>> lookups; // one sequence per hit ratio, absent_bit marks a miss
+};
+
+constexpr uint32_t absent_bit = 0x80000000u;
+
+template<typename K>
+bench_data<K> make_data(const bench_config& config, size_t size) {
+    bench_data<K> data;
+    data.present.reserve(size);
+    data.absent.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        data.present.push_back(key_maker<K>::make(i, config.seed));
+        data.absent.push_back(key_maker<K>::make(size + i, config.seed));
+    }
+
+    std::mt19937_64 rng(config.seed ^ size);
+    data.erase_order.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        data.erase_order[i] = static_cast<uint32_t>(i);
+    }
+    std::shuffle(data.erase_order.begin(), data.erase_order.end(), rng);
+
+    if (config.mode == "memory") {
+        return data; // no lookups are timed, and the sequences would only blur the RSS numbers
+    }
+
+    size_t num_lookups = std::max(size, config.min_lookups);
+    std::uniform_int_distribution<uint32_t> pick(0, static_cast<uint32_t>(size - 1));
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    for (double hit_ratio : config.hit_ratios) {
+        std::vector<uint32_t> sequence(num_lookups);
+        for (uint32_t& lookup : sequence) {
+            lookup = pick(rng) | (coin(rng) < hit_ratio ? 0 : absent_bit);
+        }
+        data.lookups.push_back(std::move(sequence));
     }
     return data;
 }
 
-// 测试插入性能的函数
-template <typename MapType>
-long long test_insert_performance(const std::vector<uint64_t>& data) {
-    auto start = std::chrono::high_resolution_clock::now();
+double elapsed_ns(bench_clock::time_point start, bench_clock::time_point end) {
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+// rdtscp waits for the preceding operation to finish, so a sample covers exactly one operation
+inline uint64_t read_ticks() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    unsigned int aux;
+    return __rdtscp(&aux);
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            bench_clock::now().time_since_epoch()).count());
+#endif
+}
+
+struct tick_clock {
+    double ns_per_tick = 1;
+    double overhead_ns = 0;
+
+    static tick_clock calibrate() {
+        tick_clock clock;
+        auto start = bench_clock::now();
+        uint64_t first_tick = read_ticks();
+        while (bench_clock::now() - start < std::chrono::milliseconds(50)) {}
+        uint64_t last_tick = read_ticks();
+        auto end = bench_clock::now();
+        clock.ns_per_tick = elapsed_ns(start, end) / std::max<uint64_t>(last_tick - first_tick, 1);
+
+        uint64_t fastest = ~uint64_t(0);
+        for (int i = 0; i < 1000; ++i) {
+            uint64_t before = read_ticks();
+            uint64_t after = read_ticks();
+            fastest = std::min(fastest, after - before);
+        }
+        clock.overhead_ns = clock.to_ns(fastest);
+        return clock;
+    }
+
+    double to_ns(uint64_t ticks) const {
+        return ticks * ns_per_tick;
+    }
+};
+
+/**
+ * An HDR-style histogram of latencies in ns: exact below 128 ns, above that 64 buckets per power
+ * of two, so any recorded value is off by less than 1.6% and the whole range fits in 30KB.
+ * Percentiles report the top of their bucket, capped at the largest value recorded.
+*/
+class latency_histogram {
+    static constexpr size_t exact_limit = 128;
+    static constexpr size_t sub_buckets = 64;
+    static constexpr size_t num_buckets = exact_limit + 57 * sub_buckets;
+
+public:
+    latency_histogram() : _counts(num_buckets) {}
+
+    void record(uint64_t ns) {
+        ++_counts[bucket_for(ns)];
+        ++_count;
+        _max = std::max(_max, ns);
+    }
+
+    uint64_t percentile(double percent) const {
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percent / 100 * _count)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < num_buckets; ++i) {
+            seen += _counts[i];
+            if (seen >= target) {
+                return std::min(bucket_top(i), _max);
+            }
+        }
+        return _max;
+    }
+
+    uint64_t count() const {
+        return _count;
+    }
+
+    uint64_t max() const {
+        return _max;
+    }
+
+private:
+    std::vector<uint64_t> _counts;
+    uint64_t _count = 0;
+    uint64_t _max = 0;
+
+    static size_t bucket_for(uint64_t value) {
+        if (value < exact_limit) {
+            return static_cast<size_t>(value);
+        }
+        size_t top_bit = 7;
+        while (top_bit < 63 && (value >> (top_bit + 1))) {
+            ++top_bit;
+        }
+        size_t shift = top_bit - 6;
+        return exact_limit + (shift - 1) * sub_buckets + static_cast<size_t>((value >> shift) - sub_buckets);
+    }
+
+    static uint64_t bucket_top(size_t bucket) {
+        if (bucket < exact_limit) {
+            return bucket;
+        }
+        size_t shift = (bucket - exact_limit) / sub_buckets + 1;
+        uint64_t mantissa = (bucket - exact_limit) % sub_buckets + sub_buckets;
+        return ((mantissa + 1) << shift) - 1;
+    }
+};
+
+// runs op(0) ... op(count - 1), timing every sample_every'th call into histogram when there is one
+template<typename Op>
+void record_each(size_t count, size_t sample_every, const tick_clock& clock, latency_histogram* histogram, Op op) {
+    for (size_t i = 0; i < count; ++i) {
+        if (histogram && i % sample_every == 0) {
+            uint64_t start = read_ticks();
+            op(i);
+            uint64_t end = read_ticks();
+            histogram->record(static_cast<uint64_t>(clock.to_ns(end - start) + 0.5));
+        } else {
+            op(i);
+        }
+    }
+}
+
+template<typename Map, typename K>
+double time_insert(const std::vector<K>& keys, float load_factor) {
+    Map map;
+    map.max_load_factor(load_factor);
+    auto start = bench_clock::now();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        map.emplace(keys[i], static_cast<uint32_t>(i));
+    }
+    auto end = bench_clock::now();
+    g_sink = g_sink + map.size();
+    return elapsed_ns(start, end) / keys.size();
+}
+
+template<typename Map, typename K>
+double time_find(const Map& map, const bench_data<K>& data, const std::vector<uint32_t>& sequence) {
+    uint64_t found = 0;
+    auto start = bench_clock::now();
+    for (uint32_t lookup : sequence) {
+        const K& key = lookup & absent_bit ? data.absent[lookup & ~absent_bit] : data.present[lookup];
+        auto it = map.find(key);
+        if (it != map.end()) {
+            found += it->second;
+        }
+    }
+    auto end = bench_clock::now();
+    g_sink = g_sink + found;
+    return elapsed_ns(start, end) / sequence.size();
+}
 
-    MapType map;
-    for (auto& elem : data) {
-        map[elem] = elem;
+template<typename Map, typename K>
+double time_erase(Map& map, const bench_data<K>& data) {
+    size_t erased = 0;
+    auto start = bench_clock::now();
+    for (uint32_t index : data.erase_order) {
+        erased += map.erase(data.present[index]);
     }
+    auto end = bench_clock::now();
+    g_sink = g_sink + erased;
+    return elapsed_ns(start, end) / data.erase_order.size();
+}
 
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+template<typename Run>
+sample_stats measure(const bench_config& config, Run run) {
+    for (size_t i = 0; i < config.warmup; ++i) {
+        run();
+    }
+    std::vector<double> samples;
+    for (size_t i = 0; i < config.reps; ++i) {
+        samples.push_back(run());
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t middle = samples.size() / 2;
+    double median = samples.size() % 2 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+    double mean = 0;
+    for (double sample : samples) {
+        mean += sample;
+    }
+    mean /= samples.size();
+    double variance = 0;
+    for (double sample : samples) {
+        variance += (sample - mean) * (sample - mean);
+    }
+    variance = samples.size() > 1 ? variance / (samples.size() - 1) : 0;
+    return { median, std::sqrt(variance), samples.front() };
 }
 
-// 测试查找性能的函数
-template <typename MapType>
-long long test_lookup_performance(const std::vector<uint64_t>& data, MapType& map) {
-    auto start = std::chrono::high_resolution_clock::now();
+class json_writer {
+public:
+    json_writer(const bench_config& config, const tick_clock& clock) {
+        bool latency = config.mode == "latency";
+        std::cout << "{\n  \"mode\": \"" << config.mode << "\",\n"
+                  << "  \"seed\": " << config.seed << ",\n"
+                  << "  \"warmup\": " << config.warmup << ",\n"
+                  << "  \"reps\": " << config.reps << ",\n"
+                  << "  \"unit\": \"" << (latency ? "ns" : config.mode == "memory" ? "bytes" : "ns/op") << "\",\n";
+        if (latency) {
+            std::cout << "  \"timer\": \"" << BENCH_TIMER_NAME << "\",\n"
+                      << "  \"timer_overhead_ns\": " << clock.overhead_ns << ",\n"
+                      << "  \"sample_every\": " << config.sample_every << ",\n";
+        }
+        std::cout << "  \"results\": [";
+    }
+
+    ~json_writer() {
+        std::cout << "\n  ]\n}" << std::endl;
+    }
+
+    // hit_ratio < 0 is written as null, insert and erase do not have one
+    void write(const std::string& table, const std::string& key, const std::string& policy, size_t size, float load_factor,
+               const std::string& operation, double hit_ratio, const sample_stats& stats) {
+        std::ostringstream line;
+        line.precision(3);
+        line << std::fixed << (_first ? "\n" : ",\n")
+             << "    {\"table\": \"" << table << "\", \"key\": \"" << key << "\", \"policy\": \"" << policy << "\", \"size\": " << size
+             << ", \"load_factor\": " << load_factor << ", \"op\": \"" << operation << "\", \"hit_ratio\": ";
+        if (hit_ratio < 0) {
+            line << "null";
+        } else {
+            line << hit_ratio;
+        }
+        line << ", \"median\": " << stats.median << ", \"stddev\": " << stats.stddev << ", \"min\": " << stats.min << "}";
+        std::cout << line.str();
+        _first = false;
+    }
+
+    void write_latency(const std::string& table, const std::string& key, const std::string& policy, size_t size, float load_factor,
+                       const std::string& operation, const latency_histogram& histogram) {
+        std::ostringstream line;
+        line.precision(3);
+        line << std::fixed << (_first ? "\n" : ",\n")
+             << "    {\"table\": \"" << table << "\", \"key\": \"" << key << "\", \"policy\": \"" << policy << "\", \"size\": " << size
+             << ", \"load_factor\": " << load_factor << ", \"op\": \"" << operation << "\""
+             << ", \"count\": " << histogram.count()
+             << ", \"p50\": " << histogram.percentile(50) << ", \"p99\": " << histogram.percentile(99)
+             << ", \"p999\": " << histogram.percentile(99.9) << ", \"p9999\": " << histogram.percentile(99.99)
+             << ", \"max\": " << histogram.max() << "}";
+        std::cout << line.str();
+        _first = false;
+    }
 
-    for (auto& elem : data) {
-        auto it = map.find(elem);
-        if (it == map.end()) {
-            // std::cerr << "Error: Element not found." << std::endl;
+    // rss_peak_delta_kb is null where VmHWM could not be reset
+    void write_memory(const std::string& table, const std::string& key, const std::string& policy, size_t size, float load_factor,
+                      size_t bucket_count, const allocation_stats& stats, long long rss_delta_kb,
+                      long long rss_peak_delta_kb, bool has_peak_delta) {
+        std::ostringstream line;
+        line.precision(3);
+        line << std::fixed << (_first ? "\n" : ",\n")
+             << "    {\"table\": \"" << table << "\", \"key\": \"" << key << "\", \"policy\": \"" << policy << "\", \"size\": " << size
+             << ", \"load_factor\": " << load_factor << ", \"bucket_count\": " << bucket_count
+             << ", \"live_bytes\": " << stats.live_bytes << ", \"peak_bytes\": " << stats.peak_bytes
+             << ", \"allocations\": " << stats.allocations
+             << ", \"bytes_per_element\": " << static_cast<double>(stats.live_bytes) / size
+             << ", \"peak_bytes_per_element\": " << static_cast<double>(stats.peak_bytes) / size
+             << ", \"rss_delta_kb\": " << rss_delta_kb << ", \"rss_peak_delta_kb\": ";
+        if (has_peak_delta) {
+            line << rss_peak_delta_kb;
+        } else {
+            line << "null";
         }
+        line << "}";
+        std::cout << line.str();
+        _first = false;
     }
 
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+private:
+    bool _first = true;
+};
+
+template<typename Table, typename K, typename H>
+void run_configuration(const bench_config& config, const bench_data<K>& data, const std::string& key_name,
+                       const std::string& policy, json_writer& out) {
+    using Map = bench_map<Table, K, H>;
+    size_t size = data.present.size();
+    for (double load_factor_value : config.load_factors) {
+        float load_factor = static_cast<float>(load_factor_value);
+        std::cerr << Table::name << " " << key_name << " " << policy << " size=" << size
+                  << " load_factor=" << load_factor << std::endl;
+
+        sample_stats inserts = measure(config, [&] { return time_insert<Map>(data.present, load_factor); });
+        out.write(Table::name, key_name, policy, size, load_factor, "insert", -1, inserts);
+
+        Map map;
+        map.max_load_factor(load_factor);
+        for (size_t i = 0; i < size; ++i) {
+            map.emplace(data.present[i], static_cast<uint32_t>(i));
+        }
+        for (size_t i = 0; i < config.hit_ratios.size(); ++i) {
+            sample_stats finds = measure(config, [&] { return time_find(map, data, data.lookups[i]); });
+            out.write(Table::name, key_name, policy, size, load_factor, "find", config.hit_ratios[i], finds);
+        }
+
+        // every repetition erases from a freshly built table, not every table here can be copied
+        sample_stats erases = measure(config, [&] {
+            Map erased;
+            erased.max_load_factor(load_factor);
+            for (size_t i = 0; i < size; ++i) {
+                erased.emplace(data.present[i], static_cast<uint32_t>(i));
+            }
+            return time_erase(erased, data);
+        });
+        out.write(Table::name, key_name, policy, size, load_factor, "erase", -1, erases);
+    }
 }
 
-int main() {
-    // 生成随机数据
-    auto data = generate_random_data(TEST_SIZE);
+// warmup passes run untimed, the measured passes all record into the same histograms
+template<typename Table, typename K, typename H>
+void run_latency(const bench_config& config, const bench_data<K>& data, const std::string& key_name,
+                 const std::string& policy, const tick_clock& clock, json_writer& out) {
+    using Map = bench_map<Table, K, H>;
+    size_t size = data.present.size();
+    for (double load_factor_value : config.load_factors) {
+        float load_factor = static_cast<float>(load_factor_value);
+        std::cerr << Table::name << " latency " << key_name << " " << policy << " size=" << size
+                  << " load_factor=" << load_factor << std::endl;
+
+        latency_histogram inserts, find_hits, find_misses, erases;
+        for (size_t rep = 0; rep < config.warmup + config.reps; ++rep) {
+            bool measured = rep >= config.warmup;
+            uint64_t found = 0;
+            Map map;
+            map.max_load_factor(load_factor);
+            record_each(size, config.sample_every, clock, measured ? &inserts : nullptr, [&](size_t i) {
+                map.emplace(data.present[i], static_cast<uint32_t>(i));
+            });
+            record_each(size, config.sample_every, clock, measured ? &find_hits : nullptr, [&](size_t i) {
+                auto it = map.find(data.present[data.erase_order[i]]);
+                found += it != map.end() ? it->second : 0;
+            });
+            record_each(size, config.sample_every, clock, measured ? &find_misses : nullptr, [&](size_t i) {
+                found += map.find(data.absent[data.erase_order[i]]) != map.end();
+            });
+            record_each(size, config.sample_every, clock, measured ? &erases : nullptr, [&](size_t i) {
+                found += map.erase(data.present[data.erase_order[i]]);
+            });
+            g_sink = g_sink + found;
+        }
+
+        out.write_latency(Table::name, key_name, policy, size, load_factor, "insert", inserts);
+        out.write_latency(Table::name, key_name, policy, size, load_factor, "find_hit", find_hits);
+        out.write_latency(Table::name, key_name, policy, size, load_factor, "find_miss", find_misses);
+        out.write_latency(Table::name, key_name, policy, size, load_factor, "erase", erases);
+    }
+}
 
-    long long total_insert_time_faster = 0;
-    long long total_lookup_time_faster = 0;
-    long long total_insert_time_std = 0;
-    long long total_lookup_time_std = 0;
+// one build per load factor, the allocator's numbers are the same on every run
+template<typename Table, typename K, typename H>
+void run_memory(const bench_config& config, const bench_data<K>& data, const std::string& key_name,
+                const std::string& policy, json_writer& out) {
+    using Map = bench_map<Table, K, H, counting_allocator<typename Table::template value<K, uint32_t>>>;
+    size_t size = data.present.size();
+    for (double load_factor_value : config.load_factors) {
+        float load_factor = static_cast<float>(load_factor_value);
+        std::cerr << Table::name << " memory " << key_name << " " << policy << " size=" << size
+                  << " load_factor=" << load_factor << std::endl;
 
-    FasterHashTable faster_map;
-    std::unordered_map<int, int> std_map;
+        bool has_peak_delta = reset_peak_rss();
+        size_t rss_before = read_status_kb("VmRSS");
+        g_allocations = allocation_stats();
+        {
+            Map map;
+            map.max_load_factor(load_factor);
+            for (size_t i = 0; i < size; ++i) {
+                map.emplace(data.present[i], static_cast<uint32_t>(i));
+            }
+            long long rss_delta = static_cast<long long>(read_status_kb("VmRSS")) - static_cast<long long>(rss_before);
+            long long rss_peak_delta = static_cast<long long>(read_status_kb("VmHWM")) - static_cast<long long>(rss_before);
+            out.write_memory(Table::name, key_name, policy, size, load_factor, map.bucket_count(), g_allocations,
+                             rss_delta, rss_peak_delta, has_peak_delta);
+        }
+    }
+}
 
-    for (int i = 0; i < NUM_TESTS; ++i) {
-        // 测试自定义哈希表
-        std::cout << "has passed: " << i << std::endl;
-        total_insert_time_faster += test_insert_performance<FasterHashTable>(data);
-        total_lookup_time_faster += test_lookup_performance(data, faster_map);
+template<typename Table, typename K, typename H>
+void run_table(const bench_config& config, const bench_data<K>& data, const std::string& key_name,
+               const std::string& policy, const tick_clock& clock, json_writer& out) {
+    if (config.mode == "latency") {
+        run_latency<Table, K, H>(config, data, key_name, policy, clock, out);
+    } else if (config.mode == "memory") {
+        run_memory<Table, K, H>(config, data, key_name, policy, out);
+    } else {
+        run_configuration<Table, K, H>(config, data, key_name, policy, out);
+    }
+}
 
-        // 测试标准库哈希表
-        total_insert_time_std += test_insert_performance<std::unordered_map<int, int>>(data);
-        total_lookup_time_std += test_lookup_performance(data, std_map);
+template<typename Table, typename K, typename H>
+void run_policies(const bench_config& config, const bench_data<K>& data, const std::string& key_name,
+                  const tick_clock& clock, json_writer& out) {
+    if constexpr (!Table::has_policies) {
+        run_table<Table, K, H>(config, data, key_name, "default", clock, out);
+    } else {
+        for (const std::string& policy : config.policies) {
+            if (policy == "fibonacci") {
+                run_table<Table, K, policy_hash<H, ddaof::fibonacci_hash_policy>>(config, data, key_name, policy, clock, out);
+            } else if (policy == "power_of_two") {
+                run_table<Table, K, policy_hash<H, ddaof::power_of_two_hash_policy>>(config, data, key_name, policy, clock, out);
+            } else if (policy == "prime") {
+                run_table<Table, K, policy_hash<H, ddaof::prime_number_hash_policy>>(config, data, key_name, policy, clock, out);
+#ifdef BENCH_FASTRANGE
+            } else if (policy == "fastrange") {
+                run_table<Table, K, policy_hash<H, ddaof::fastrange_hash_policy<>>>(config, data, key_name, policy, clock, out);
+#endif
+            } else {
+                std::cerr << "skipping policy " << policy << ": not available in " << Table::name << std::endl;
+            }
+        }
     }
+}
 
-    std::cout << "Average insert time (FasterHashTable): " << total_insert_time_faster / NUM_TESTS << " ms\n";
-    std::cout << "Average lookup time (FasterHashTable): " << total_lookup_time_faster / NUM_TESTS << " ms\n";
-    std::cout << "Average insert time (std::unordered_map): " << total_insert_time_std / NUM_TESTS << " ms\n";
-    std::cout << "Average lookup time (std::unordered_map): " << total_lookup_time_std / NUM_TESTS << " ms\n";
+// runs the table of the list called table_name, false when there is none
+template<typename K, typename H, typename... Tables>
+bool run_named_table(table_list<Tables...>, const std::string& table_name, const bench_config& config,
+                     const bench_data<K>& data, const std::string& key_name, const tick_clock& clock, json_writer& out) {
+    return ((table_name == Tables::name && (run_policies<Tables, K, H>(config, data, key_name, clock, out), true)) || ...);
+}
 
+template<typename K, typename H>
+void run_key_type(const bench_config& config, const std::string& key_name, const tick_clock& clock, json_writer& out) {
+    for (size_t size : config.sizes) {
+        // keys, absent keys, the table and the one that erase works on, plus the lookup sequences
+        size_t estimated_bytes = size * (key_maker<K>::bytes_per_key * 6 + 64)
+                                 + std::max(size, config.min_lookups) * sizeof(uint32_t) * config.hit_ratios.size();
+        if (size == 0 || size >= absent_bit || estimated_bytes / (1024 * 1024) > config.max_memory_mb) {
+            std::cerr << "skipping " << key_name << " size=" << size << ": needs about "
+                      << estimated_bytes / (1024 * 1024) << " MB, over --max-memory-mb" << std::endl;
+            continue;
+        }
+        // every table sees the same keys and lookup sequences
+        bench_data<K> data = make_data<K>(config, size);
+        for (const std::string& table : config.tables) {
+            if (!run_named_table<K, H>(bench_tables(), table, config, data, key_name, clock, out)) {
+                std::cerr << "skipping table " << table << ": not available in this build" << std::endl;
+            }
+        }
+    }
+}
+
+template<typename T>
+std::vector<T> parse_list(const std::string& value) {
+    std::vector<T> result;
+    std::istringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        std::istringstream item_in(item);
+        T parsed;
+        if (!(item_in >> parsed)) {
+            throw std::invalid_argument("Cannot parse list item: " + item);
+        }
+        result.push_back(parsed);
+    }
+    return result;
+}
+
+bool parse_arguments(int argc, char** argv, bench_config& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        size_t equals = argument.find('=');
+        std::string name = argument.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+        if (name == "--tables") {
+            config.tables = parse_list<std::string>(value);
+        } else if (name == "--sizes") {
+            config.sizes = parse_list<size_t>(value);
+        } else if (name == "--keys") {
+            config.keys = parse_list<std::string>(value);
+        } else if (name == "--policies") {
+            config.policies = parse_list<std::string>(value);
+        } else if (name == "--hit-ratios") {
+            config.hit_ratios = parse_list<double>(value);
+        } else if (name == "--load-factors") {
+            config.load_factors = parse_list<double>(value);
+        } else if (name == "--warmup") {
+            config.warmup = std::stoul(value);
+        } else if (name == "--reps") {
+            config.reps = std::max<size_t>(std::stoul(value), 1);
+        } else if (name == "--min-lookups") {
+            config.min_lookups = std::stoul(value);
+        } else if (name == "--max-memory-mb") {
+            config.max_memory_mb = std::stoul(value);
+        } else if (name == "--seed") {
+            config.seed = std::stoull(value);
+        } else if (name == "--mode" && (value == "throughput" || value == "latency" || value == "memory")) {
+            config.mode = value;
+        } else if (name == "--sample-every") {
+            config.sample_every = std::max<size_t>(std::stoul(value), 1);
+        } else {
+            std::string tables;
+            for (const std::string& table : table_names(bench_tables())) {
+                tables += (tables.empty() ? "" : ",") + table;
+            }
+            std::cerr << "usage: " << argv[0] << " [--tables=" << tables << "]\n"
+                      << "    [--sizes=1000,...] [--keys=int,uint64,string64,string_with_hash]\n"
+                      << "    [--policies=fibonacci,power_of_two,prime,fastrange] [--hit-ratios=1,0.5,0]\n"
+                      << "    [--load-factors=0.5,0.875] [--warmup=1] [--reps=5] [--min-lookups=1048576]\n"
+                      << "    [--max-memory-mb=8192] [--seed=N] [--mode=throughput|latency|memory] [--sample-every=1]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bench_config config;
+    try {
+        if (!parse_arguments(argc, argv, config)) {
+            return 1;
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    tick_clock clock;
+    if (config.mode == "latency") {
+        clock = tick_clock::calibrate();
+    }
+    json_writer out(config, clock);
+    for (const std::string& key : config.keys) {
+        if (key == "int") {
+            run_key_type<int, std::hash<int>>(config, key, clock, out);
+        } else if (key == "uint64") {
+            run_key_type<uint64_t, std::hash<uint64_t>>(config, key, clock, out);
+        } else if (key == "string64") {
+            run_key_type<std::string, std::hash<std::string>>(config, key, clock, out);
+#ifdef BENCH_STRING_WITH_HASH
+        } else if (key == "string_with_hash") {
+            run_key_type<ddaof::string_with_hash, string_with_hash_hasher>(config, key, clock, out);
+#endif
+        } else {
+            std::cerr << "skipping key type " << key << ": not available in this build" << std::endl;
+        }
+    }
     return 0;
 }
@@ -17,7 +17,7 @@ public:
     using const_reference = const value_type&;
 
     template<typename U> struct rebind {
-        using other = typename AmnesiaAllocator<U>;
+        using other = AmnesiaAllocator<U>;
     };
 
     AmnesiaAllocator() noexcept
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+#include <stddef.h>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace ddaof {
+
+/**
+ * Customization point for deep_memory_usage(): the heap bytes an element owns beyond its own sizeof.
+ * The default is zero, which is right for trivially copyable keys and values.
+ * Specialize it for types that own memory:
+ *
+ *     template<>
+ *     struct owned_heap_bytes<my_blob> {
+ *         size_t operator()(const my_blob& blob) const { return blob.capacity(); }
+ *     };
+*/
+template<typename T>
+struct owned_heap_bytes {
+    size_t operator()(const T&) const {
+        return 0;
+    }
+};
+
+// a string only owns heap memory once it has outgrown its small string buffer,
+// which is exactly when its data no longer points into the object itself
+template<typename Char, typename Traits, typename Alloc>
+struct owned_heap_bytes<std::basic_string<Char, Traits, Alloc>> {
+    size_t operator()(const std::basic_string<Char, Traits, Alloc>& str) const {
+        const char* data = reinterpret_cast<const char*>(str.data());
+        const char* object = reinterpret_cast<const char*>(std::addressof(str));
+        if (data >= object && data < object + sizeof(str)) {
+            return 0;
+        }
+        return (str.capacity() + 1) * sizeof(Char);
+    }
+};
+
+template<typename First, typename Second>
+struct owned_heap_bytes<std::pair<First, Second>> {
+    size_t operator()(const std::pair<First, Second>& pair) const {
+        return owned_heap_bytes<typename std::remove_const<First>::type>()(pair.first)
+             + owned_heap_bytes<typename std::remove_const<Second>::type>()(pair.second);
+    }
+};
+
+template<typename T>
+size_t owned_heap_bytes_of(const T& value) {
+    return owned_heap_bytes<T>()(value);
+}
+
+} // end namespace ddaof
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <type_traits>
+
+#include "faster_hashtable.hpp"
+
+namespace ddaof {
+
+/**
+ * A map that keeps up to N elements inline in the object and finds them with a linear scan,
+ * without hashing and without touching the heap.
+ * The first insert past N moves everything into a regular flat_hash_map, and the map stays there
+ * (clear() keeps the buckets, like faster_hashtable::clear does).
+*/
+template<typename K, typename V, size_t N = 8, typename H = std::hash<K>, typename E = std::equal_to<K>,
+         typename A = std::allocator<std::pair<K, V> > >
+class small_flat_map : private E {
+    using Map = ddaof::flat_hash_map<K, V, H, E, A>;
+
+    static_assert(N > 0, "small_flat_map needs at least one inline slot");
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using hasher = H;
+    using key_equal = E;
+    using allocator_type = A;
+
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+    small_flat_map() {}
+
+    small_flat_map(std::initializer_list<value_type> initializer_list) {
+        insert(initializer_list.begin(), initializer_list.end());
+    }
+
+    small_flat_map(const small_flat_map& other)
+            : E(other), _map(other._map), _spilled(other._spilled) {
+        for (size_t i = 0; i < other._inline_size; ++i) {
+            new (inline_slot(i)) value_type(*other.inline_slot(i));
+            ++_inline_size;
+        }
+    }
+
+    small_flat_map(small_flat_map&& other)
+            : E(std::move(other)), _map(std::move(other._map)), _spilled(other._spilled) {
+        for (size_t i = 0; i < other._inline_size; ++i) {
+            new (inline_slot(i)) value_type(std::move(*other.inline_slot(i)));
+            ++_inline_size;
+        }
+        other.destroy_inline();
+        other._spilled = false;
+    }
+
+    small_flat_map& operator=(const small_flat_map& other) {
+        if (this != std::addressof(other)) {
+            small_flat_map copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    small_flat_map& operator=(small_flat_map&& other) {
+        if (this != std::addressof(other)) {
+            destroy_inline();
+            static_cast<E&>(*this) = std::move(other);
+            _map = std::move(other._map);
+            _spilled = other._spilled;
+            for (size_t i = 0; i < other._inline_size; ++i) {
+                new (inline_slot(i)) value_type(std::move(*other.inline_slot(i)));
+                ++_inline_size;
+            }
+            other.destroy_inline();
+            other._spilled = false;
+        }
+        return *this;
+    }
+
+    ~small_flat_map() {
+        destroy_inline();
+    }
+
+    template<typename ValueType, typename MapIterator>
+    struct templated_iterator {
+        templated_iterator() = default;
+        templated_iterator(ValueType* inline_current, MapIterator map_current)
+                : inline_current(inline_current), map_current(map_current) {}
+
+        // inline_current is null once the map has spilled
+        ValueType* inline_current = nullptr;
+        MapIterator map_current = MapIterator();
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ValueType;
+        using difference_type = ptrdiff_t;
+        using pointer = ValueType*;
+        using reference = ValueType&;
+
+        friend bool operator==(const templated_iterator& lhs, const templated_iterator& rhs) {
+            return lhs.inline_current == rhs.inline_current && lhs.map_current == rhs.map_current;
+        }
+        friend bool operator!=(const templated_iterator& lhs, const templated_iterator& rhs) {
+            return !(lhs == rhs);
+        }
+
+        templated_iterator& operator++() {
+            if (inline_current) {
+                ++inline_current;
+            } else {
+                ++map_current;
+            }
+            return *this;
+        }
+
+        templated_iterator operator++(int) {
+            templated_iterator copy(*this);
+            ++*this;
+            return copy;
+        }
+
+        ValueType& operator*() const {
+            return inline_current ? *inline_current : *map_current;
+        }
+
+        ValueType* operator->() const {
+            return inline_current ? inline_current : std::addressof(*map_current);
+        }
+
+        operator templated_iterator<const ValueType, typename Map::const_iterator>() const {
+            return { inline_current, map_current };
+        }
+    };
+
+    using iterator = templated_iterator<value_type, typename Map::iterator>;
+    using const_iterator = templated_iterator<const value_type, typename Map::const_iterator>;
+
+    iterator begin() {
+        if (_spilled) {
+            return { nullptr, _map.begin() };
+        }
+        return { inline_slot(0), typename Map::iterator() };
+    }
+
+    const_iterator begin() const {
+        return const_cast<small_flat_map*>(this)->begin();
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    iterator end() {
+        if (_spilled) {
+            return { nullptr, _map.end() };
+        }
+        return { inline_slot(_inline_size), typename Map::iterator() };
+    }
+
+    const_iterator end() const {
+        return const_cast<small_flat_map*>(this)->end();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    iterator find(const K& key) {
+        if (_spilled) {
+            return { nullptr, _map.find(key) };
+        }
+        return { inline_slot(find_inline(key)), typename Map::iterator() };
+    }
+
+    const_iterator find(const K& key) const {
+        return const_cast<small_flat_map*>(this)->find(key);
+    }
+
+    size_t count(const K& key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    template<typename Key, typename ...Args>
+    std::pair<iterator, bool> emplace(Key&& key, Args&& ...args) {
+        if (_spilled) {
+            auto result = _map.emplace(std::forward<Key>(key), std::forward<Args>(args)...);
+            return { { nullptr, result.first }, result.second };
+        }
+
+        size_t index = find_inline(key);
+        if (index != _inline_size) {
+            return { { inline_slot(index), typename Map::iterator() }, false };
+        } else if (_inline_size == N) {
+            spill(N + 1);
+            return emplace(std::forward<Key>(key), std::forward<Args>(args)...);
+        }
+
+        new (inline_slot(_inline_size)) value_type(std::forward<Key>(key), std::forward<Args>(args)...);
+        ++_inline_size;
+        return { { inline_slot(index), typename Map::iterator() }, true };
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return emplace(value.first, value.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return emplace(std::move(value.first), std::move(value.second));
+    }
+
+    template<typename It>
+    void insert(It begin, It end) {
+        for (; begin != end; ++begin) {
+            insert(*begin);
+        }
+    }
+
+    inline V& operator[](const K& key) {
+        return emplace(key, convertible_to_value()).first->second;
+    }
+
+    inline V& operator[](K&& key) {
+        return emplace(std::move(key), convertible_to_value()).first->second;
+    }
+
+    V& at(const K& key) {
+        auto found = find(key);
+        if (found == end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+    const V& at(const K& key) const {
+        auto found = find(key);
+        if (found == end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+    // the inline storage is unordered, so erasing moves the last element into the hole
+    void erase(const_iterator to_erase) {
+        if (_spilled) {
+            _map.erase(to_erase.map_current);
+            return;
+        }
+
+        value_type* hole = const_cast<value_type*>(to_erase.inline_current);
+        value_type* last = inline_slot(_inline_size - 1);
+        if (hole != last) {
+            hole->~value_type();
+            new (hole) value_type(std::move(*last));
+        }
+        last->~value_type();
+        --_inline_size;
+    }
+
+    size_t erase(const K& key) {
+        auto found = find(key);
+        if (found == end()) {
+            return 0;
+        } else {
+            erase(found);
+            return 1;
+        }
+    }
+
+    void clear() {
+        destroy_inline();
+        _map.clear();
+    }
+
+    void reserve(size_t num_elements) {
+        if (_spilled) {
+            _map.reserve(num_elements);
+        } else if (num_elements > N) {
+            spill(num_elements);
+        }
+    }
+
+    size_t size() const {
+        return _spilled ? _map.size() : _inline_size;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    bool is_inline() const {
+        return !_spilled;
+    }
+
+    static constexpr size_t inline_capacity() {
+        return N;
+    }
+
+    // heap bytes only, the inline slots are part of sizeof(small_flat_map)
+    size_t memory_usage() const {
+        return _map.memory_usage();
+    }
+
+    // memory_usage() plus the heap memory owned by the elements, see owned_heap_bytes, O(size())
+    size_t deep_memory_usage() const {
+        size_t result = _map.deep_memory_usage();
+        for (size_t i = 0; i < _inline_size; ++i) {
+            result += owned_heap_bytes_of(*inline_slot(i));
+        }
+        return result;
+    }
+
+    friend bool operator==(const small_flat_map& lhs, const small_flat_map& rhs) {
+        if (lhs.size() != rhs.size())
+            return false;
+        for (const value_type& value : lhs) {
+            auto found = rhs.find(value.first);
+            if (found == rhs.end())
+                return false;
+            else if (value.second != found->second)
+                return false;
+        }
+        return true;
+    }
+
+    friend bool operator!=(const small_flat_map& lhs, const small_flat_map& rhs) {
+        return !(lhs == rhs);
+    }
+
+private:
+    typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type _inline[N];
+    size_t _inline_size = 0;
+    Map _map;
+    bool _spilled = false;
+
+    value_type* inline_slot(size_t index) {
+        return reinterpret_cast<value_type*>(std::addressof(_inline[0])) + index;
+    }
+
+    const value_type* inline_slot(size_t index) const {
+        return reinterpret_cast<const value_type*>(std::addressof(_inline[0])) + index;
+    }
+
+    template<typename Key>
+    size_t find_inline(const Key& key) {
+        size_t index = 0;
+        for (; index < _inline_size; ++index) {
+            if (static_cast<E&>(*this)(key, inline_slot(index)->first)) {
+                break;
+            }
+        }
+        return index;
+    }
+
+    DDAOF_NOINLINE(void) spill(size_t num_elements) {
+        _map.reserve(num_elements);
+        for (size_t i = 0; i < _inline_size; ++i) {
+            _map.emplace(std::move(inline_slot(i)->first), std::move(inline_slot(i)->second));
+        }
+        destroy_inline();
+        _spilled = true;
+    }
+
+    void destroy_inline() {
+        for (size_t i = 0; i < _inline_size; ++i) {
+            inline_slot(i)->~value_type();
+        }
+        _inline_size = 0;
+    }
+
+    struct convertible_to_value {
+        operator V() const {
+            return V();
+        }
+    };
+};
+
+} // end namespace ddaof
@@ -0,0 +1,418 @@
+#pragma once
+
+#include <array>
+#include <type_traits>
+#include <utility>
+
+#include "faster_hashtable.hpp"
+
+namespace ddaof {
+
+/**
+ * A fixed-capacity robin-hood map that lives entirely inside the object.
+ * The slots are a std::array of faster_table_entry with the same layout as faster_hashtable
+ * (Capacity slots, MaxLookups - 1 overflow slots and the special end item), the index uses
+ * power_of_two_hash_policy with a compile-time mask (pre-mixed for weak hashers, see hash_needs_mixing),
+ * and the probe bound is a constant.
+ * It never allocates and never rehashes: when a key does not fit, emplace reports it
+ * by returning end() and false instead of growing.
+*/
+template<typename K, typename V, size_t Capacity, typename H = std::hash<K>, typename E = std::equal_to<K>,
+         int8_t MaxLookups = -1>
+class static_flat_map : private ddaof::KeyOrValueHasher<K, std::pair<K, V>, H>,
+                        private ddaof::KeyOrValueEquality<K, std::pair<K, V>, E> {
+    using Hasher = ddaof::KeyOrValueHasher<K, std::pair<K, V>, H>;
+    using Equal = ddaof::KeyOrValueEquality<K, std::pair<K, V>, E>;
+    using Entry = faster_table_entry<std::pair<K, V>>;
+    using EntryPointer = Entry*;
+    using IndexPolicy = typename std::conditional<hash_needs_mixing<H, K>::value,
+                                                  premixed_hash_policy<power_of_two_hash_policy>,
+                                                  power_of_two_hash_policy>::type;
+
+    static constexpr int8_t constexpr_log2(size_t value) {
+        return value <= 1 ? 0 : 1 + constexpr_log2(value >> 1);
+    }
+
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    static constexpr size_t _num_slots_minus_one = Capacity - 1;
+    static constexpr int8_t _max_lookups = MaxLookups > 0 ? MaxLookups
+            : (constexpr_log2(Capacity) < min_lookups ? min_lookups : constexpr_log2(Capacity));
+    static constexpr size_t _num_entries = Capacity + _max_lookups;
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using hasher = H;
+    using key_equal = E;
+
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+    static_flat_map() {
+        _entries.back()._distance_from_desired = Entry::_special_end_value;
+    }
+
+    explicit static_flat_map(const H& hash, const E& equal = E())
+            : Hasher(hash), Equal(equal) {
+        _entries.back()._distance_from_desired = Entry::_special_end_value;
+    }
+
+    static_flat_map(std::initializer_list<value_type> initializer_list)
+            : static_flat_map() {
+        insert(initializer_list.begin(), initializer_list.end());
+    }
+
+    static_flat_map(const static_flat_map& other)
+            : Hasher(other), Equal(other) {
+        _entries.back()._distance_from_desired = Entry::_special_end_value;
+        copy_slots(other);
+    }
+
+    // moves the elements slot by slot and leaves other empty
+    static_flat_map(static_flat_map&& other) noexcept(std::is_nothrow_move_constructible<value_type>::value)
+            : Hasher(std::move(other)), Equal(std::move(other)) {
+        _entries.back()._distance_from_desired = Entry::_special_end_value;
+        move_slots(other);
+    }
+
+    static_flat_map& operator=(const static_flat_map& other) {
+        if (this != std::addressof(other)) {
+            clear();
+            static_cast<Hasher&>(*this) = other;
+            static_cast<Equal&>(*this) = other;
+            copy_slots(other);
+        }
+        return *this;
+    }
+
+    static_flat_map& operator=(static_flat_map&& other) noexcept(std::is_nothrow_move_constructible<value_type>::value) {
+        if (this != std::addressof(other)) {
+            clear();
+            static_cast<Hasher&>(*this) = std::move(other);
+            static_cast<Equal&>(*this) = std::move(other);
+            move_slots(other);
+        }
+        return *this;
+    }
+
+    ~static_flat_map() {
+        clear();
+    }
+
+    template<typename ValueType>
+    struct templated_iterator {
+        templated_iterator() = default;
+        templated_iterator(EntryPointer current)
+                : current(current) {}
+        EntryPointer current = EntryPointer();
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ValueType;
+        using difference_type = ptrdiff_t;
+        using pointer = ValueType*;
+        using reference = ValueType&;
+
+        friend bool operator==(const templated_iterator& lhs, const templated_iterator& rhs) {
+            return lhs.current == rhs.current;
+        }
+        friend bool operator!=(const templated_iterator& lhs, const templated_iterator& rhs) {
+            return !(lhs == rhs);
+        }
+
+        templated_iterator& operator++() {
+            do {
+                ++current;
+            }
+            while(current->is_empty());
+            return *this;
+        }
+
+        templated_iterator operator++(int) {
+            templated_iterator copy(*this);
+            ++*this;
+            return copy;
+        }
+
+        ValueType& operator*() const {
+            return current->_value;
+        }
+
+        ValueType* operator->() const {
+            return std::addressof(current->_value);
+        }
+
+        operator templated_iterator<const value_type>() const {
+            return { current };
+        }
+    };
+
+    using iterator = templated_iterator<value_type>;
+    using const_iterator = templated_iterator<const value_type>;
+
+    iterator begin() {
+        for (EntryPointer it = _entries.data(); ; ++it) {
+            if (it->has_value()) {
+                return { it };
+            }
+        }
+    }
+
+    const_iterator begin() const {
+        return const_cast<static_flat_map*>(this)->begin();
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    iterator end() {
+        return { _entries.data() + static_cast<ptrdiff_t>(_num_entries - 1) };
+    }
+
+    const_iterator end() const {
+        return const_cast<static_flat_map*>(this)->end();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    iterator find(const K& key) {
+        size_t index = IndexPolicy().index_for_hash(hash_object(key), _num_slots_minus_one);
+        EntryPointer it = _entries.data() + ptrdiff_t(index);
+        for (int8_t distance = 0; it->_distance_from_desired >= distance; ++distance, ++it) {
+            if (compares_equal(key, it->_value)) {
+                return { it };
+            }
+        }
+        return end();
+    }
+
+    const_iterator find(const K& key) const {
+        return const_cast<static_flat_map*>(this)->find(key);
+    }
+
+    size_t count(const K& key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    // returns { end(), false } when the key does not fit, the map is left unchanged
+    template<typename Key, typename ...Args>
+    std::pair<iterator, bool> emplace(Key&& key, Args&& ...args) {
+        size_t index = IndexPolicy().index_for_hash(hash_object(key), _num_slots_minus_one);
+        EntryPointer current_entry = _entries.data() + ptrdiff_t(index);
+        int8_t distance_from_desired = 0;
+        for (; current_entry->_distance_from_desired >= distance_from_desired; ++current_entry, ++distance_from_desired) {
+            if (compares_equal(key, current_entry->_value)) {
+                return std::make_pair(iterator{ current_entry }, false);
+            }
+        }
+
+        return emplace_new_key(distance_from_desired, current_entry, std::forward<Key>(key), std::forward<Args>(args)...);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return emplace(value.first, value.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return emplace(std::move(value.first), std::move(value.second));
+    }
+
+    template<typename It>
+    void insert(It begin, It end) {
+        for (; begin != end; ++begin) {
+            insert(*begin);
+        }
+    }
+
+    inline V& operator[](const K& key) {
+        return checked(emplace(key, convertible_to_value()))->second;
+    }
+
+    inline V& operator[](K&& key) {
+        return checked(emplace(std::move(key), convertible_to_value()))->second;
+    }
+
+    V& at(const K& key) {
+        auto found = find(key);
+        if (found == end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+    const V& at(const K& key) const {
+        auto found = find(key);
+        if (found == end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+    void erase(const_iterator to_erase) {
+        EntryPointer current = to_erase.current;
+        current->destroy_value();
+        --_num_elements;
+
+        for (EntryPointer next = current + ptrdiff_t(1); !next->is_at_desired_position(); ++current, ++next) {
+            current->emplace(next->_distance_from_desired - 1, std::move(next->_value));
+            next->destroy_value();
+        }
+    }
+
+    size_t erase(const K& key) {
+        auto found = find(key);
+        if (found == end()) {
+            return 0;
+        } else {
+            erase(found);
+            return 1;
+        }
+    }
+
+    void clear() {
+        for (EntryPointer it = _entries.data(), end = it + static_cast<ptrdiff_t>(_num_entries - 1); it != end; ++it) {
+            if (it->has_value()) {
+                it->destroy_value();
+            }
+        }
+        _num_elements = 0;
+    }
+
+    size_t size() const {
+        return _num_elements;
+    }
+
+    bool empty() const {
+        return _num_elements == 0;
+    }
+
+    bool full() const {
+        return _num_elements == Capacity;
+    }
+
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+
+    static constexpr size_t bucket_count() {
+        return Capacity;
+    }
+
+    static constexpr int8_t max_lookups() {
+        return _max_lookups;
+    }
+
+    float load_factor() const {
+        return static_cast<float>(_num_elements) / Capacity;
+    }
+
+    // the slots are part of sizeof(static_flat_map), so only the elements can own heap memory
+    static constexpr size_t memory_usage() {
+        return 0;
+    }
+
+    // the heap memory owned by the elements, see owned_heap_bytes, O(capacity())
+    size_t deep_memory_usage() const {
+        size_t result = 0;
+        for (const value_type& value : *this) {
+            result += owned_heap_bytes_of(value);
+        }
+        return result;
+    }
+
+private:
+    std::array<Entry, _num_entries> _entries;
+    size_t _num_elements = 0;
+
+    // the entries hold their value in a union, so copies and moves go slot by slot,
+    // over every slot but the special end item
+    void copy_slots(const static_flat_map& other) {
+        for (size_t i = 0; i + 1 < _num_entries; ++i) {
+            if (other._entries[i].has_value()) {
+                _entries[i].emplace(other._entries[i]._distance_from_desired, other._entries[i]._value);
+            }
+        }
+        _num_elements = other._num_elements;
+    }
+
+    void move_slots(static_flat_map& other) {
+        for (size_t i = 0; i + 1 < _num_entries; ++i) {
+            if (other._entries[i].has_value()) {
+                _entries[i].emplace(other._entries[i]._distance_from_desired, std::move(other._entries[i]._value));
+            }
+        }
+        _num_elements = other._num_elements;
+        other.clear();
+    }
+
+    template<typename Key, typename... Args>
+    std::pair<iterator, bool> emplace_new_key(int8_t distance_from_desired, EntryPointer current_entry, Key&& key, Args&&... args) {
+        using std::swap;
+        if (_num_elements == Capacity || distance_from_desired == _max_lookups) {
+            return std::make_pair(end(), false);
+        } else if (current_entry->is_empty()) {
+            current_entry->emplace(distance_from_desired, std::forward<Key>(key), std::forward<Args>(args)...);
+            ++_num_elements;
+            return std::make_pair(iterator{ current_entry }, true);
+        } else {/*Nothing need to do*/}
+
+        // make sure the displaced chain ends in an empty slot before touching anything,
+        // there is no grow() to fall back on
+        EntryPointer probe = current_entry;
+        for (int8_t distance = distance_from_desired; !probe->is_empty(); ++probe) {
+            distance = probe->_distance_from_desired < distance ? probe->_distance_from_desired + 1 : distance + 1;
+            if (distance == _max_lookups) {
+                return std::make_pair(end(), false);
+            }
+        }
+
+        value_type to_insert(std::forward<Key>(key), std::forward<Args>(args)...);
+        swap(distance_from_desired, current_entry->_distance_from_desired);
+        swap(to_insert, current_entry->_value);
+        iterator result = { current_entry };
+
+        for (++distance_from_desired, ++current_entry;; ++current_entry) {
+            if (current_entry->is_empty()) {
+                current_entry->emplace(distance_from_desired, std::move(to_insert));
+                ++_num_elements;
+                return { result, true };
+            } else if (current_entry->_distance_from_desired < distance_from_desired) {
+                swap(distance_from_desired, current_entry->_distance_from_desired);
+                swap(to_insert, current_entry->_value);
+            }
+            ++distance_from_desired;
+        }
+    }
+
+    iterator checked(std::pair<iterator, bool> result) {
+        if (result.first == end()) {
+            throw std::length_error("static_flat_map is full.");
+        }
+        return result.first;
+    }
+
+    template<typename U>
+    size_t hash_object(const U& key) {
+        return static_cast<Hasher&>(*this)(key);
+    }
+
+    template<typename L, typename R>
+    bool compares_equal(const L& lhs, const R& rhs) {
+        return static_cast<Equal&>(*this)(lhs, rhs);
+    }
+
+    struct convertible_to_value {
+        operator V() const {
+            return V();
+        }
+    };
+};
+
+} // end namespace ddaof
@@ -0,0 +1,94 @@
+// Renders the CSV written by faster_hashtable::dump_occupancy() as a text heat map.
+//
+//     std::ofstream out("occupancy.csv");
+//     table.dump_occupancy(out, 64);
+//     ./occupancy_heatmap occupancy.csv
+//
+// Every character is one region, darker means fuller. Each row ends with the largest
+// distance_from_desired in it, so the rows where clusters form stand out.
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Region {
+    size_t firstSlot = 0;
+    double fillRatio = 0;
+    int maxDistance = 0;
+    double meanDistance = 0;
+};
+
+bool readRegions(std::istream& in, std::vector<Region>& regions) {
+    std::string line;
+    if (!std::getline(in, line)) {
+        std::cerr << "Empty input." << std::endl;
+        return false;
+    }
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        Region region;
+        size_t slots = 0, full = 0;
+        char comma = 0;
+        if (!(fields >> region.firstSlot >> comma >> slots >> comma >> full >> comma
+                     >> region.fillRatio >> comma >> region.maxDistance >> comma >> region.meanDistance)) {
+            std::cerr << "Malformed line: " << line << std::endl;
+            return false;
+        }
+        regions.push_back(region);
+    }
+    return true;
+}
+
+void renderHeatMap(const std::vector<Region>& regions, size_t regionsPerRow) {
+    const std::string ramp = " .:-=+*#%@";
+
+    for (size_t row = 0; row < regions.size(); row += regionsPerRow) {
+        size_t rowEnd = std::min(row + regionsPerRow, regions.size());
+        int rowMaxDistance = 0;
+        std::string cells;
+        for (size_t i = row; i < rowEnd; ++i) {
+            size_t shade = static_cast<size_t>(regions[i].fillRatio * (ramp.size() - 1) + 0.5);
+            cells += ramp[std::min(shade, ramp.size() - 1)];
+            rowMaxDistance = std::max(rowMaxDistance, regions[i].maxDistance);
+        }
+        std::cout.width(10);
+        std::cout << regions[row].firstSlot << " |" << cells << "| " << rowMaxDistance << "\n";
+    }
+
+    double fillSum = 0, distanceSum = 0;
+    int maxDistance = 0;
+    for (const Region& region : regions) {
+        fillSum += region.fillRatio;
+        distanceSum += region.meanDistance * region.fillRatio;
+        maxDistance = std::max(maxDistance, region.maxDistance);
+    }
+    std::cout << "regions: " << regions.size()
+              << ", mean fill: " << (regions.empty() ? 0 : fillSum / regions.size())
+              << ", mean distance: " << (fillSum > 0 ? distanceSum / fillSum : 0)
+              << ", max distance: " << maxDistance
+              << ", scale: '" << ramp << "' (empty to full)" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::vector<Region> regions;
+    size_t regionsPerRow = argc > 2 ? std::stoul(argv[2]) : 64;
+
+    if (argc > 1) {
+        std::ifstream inFile(argv[1]);
+        if (!inFile.is_open()) {
+            std::cerr << "Failed to open file for reading." << std::endl;
+            return 1;
+        }
+        if (!readRegions(inFile, regions)) {
+            return 1;
+        }
+    } else if (!readRegions(std::cin, regions)) {
+        return 1;
+    }
+
+    renderHeatMap(regions, std::max(regionsPerRow, static_cast<size_t>(1)));
+    return 0;
+}
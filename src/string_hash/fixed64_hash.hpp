@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DDAOF_FIXED64_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ddaof {
+
+/**
+ * A hasher for keys of exactly 64 bytes, the STR_STABLE_LENGTH that string_with_hash and
+ * string_hash_cache feed to CityHash64. The key is read as four 16-byte lanes with no length branches.
+ * On x86 the kernel is picked once per process with cpuid: AES-NI rounds when available,
+ * CRC32C lanes when only SSE4.2 is, and a portable multiply-mix otherwise. The kernels give
+ * different values, so hashes are only stable within one process, never store them.
+ * Keys of another length still work: shorter keys are zero padded and mixed with their length,
+ * longer keys are hashed by their first 64 bytes like CityHash64(str, STR_STABLE_LENGTH) does.
+*/
+class fixed64_hash {
+public:
+    typedef std::true_type is_avalanching;
+
+    static constexpr size_t key_length = 64;
+
+    size_t operator()(const std::string& str) const {
+        if (str.size() >= key_length) {
+            return kernel()(str.data());
+        }
+        char padded[key_length] = {};
+        memcpy(padded, str.data(), str.size());
+        return kernel()(padded) ^ (str.size() + 1) * 0x9E3779B97F4A7C15ull;
+    }
+
+    static uint64_t hash(const char* key) {
+        return kernel()(key);
+    }
+
+    static const char* kernel_name() {
+        hash_function selected = kernel();
+#ifdef DDAOF_FIXED64_X86
+        if (selected == &hash_aes) {
+            return "aes";
+        } else if (selected == &hash_crc32c) {
+            return "crc32c";
+        }
+#endif
+        return selected == &hash_portable ? "portable" : "unknown";
+    }
+
+    static uint64_t hash_portable(const char* key) {
+        uint64_t a = mix(read8(key) ^ 0xa0761d6478bd642full, read8(key + 8) ^ 0xe7037ed1a0b428dbull);
+        uint64_t b = mix(read8(key + 16) ^ 0x8ebc6af09c88c6e3ull, read8(key + 24) ^ 0x589965cc75374cc3ull);
+        uint64_t c = mix(read8(key + 32) ^ 0xa0761d6478bd642full, read8(key + 40) ^ 0xe7037ed1a0b428dbull);
+        uint64_t d = mix(read8(key + 48) ^ 0x8ebc6af09c88c6e3ull, read8(key + 56) ^ 0x589965cc75374cc3ull);
+        return mix(a ^ c, b ^ d ^ key_length);
+    }
+
+#ifdef DDAOF_FIXED64_X86
+    // every lane goes through at least two full AES rounds before it reaches the result
+    __attribute__((target("aes,sse2"))) static uint64_t hash_aes(const char* key) {
+        const __m128i round_key = _mm_set_epi64x(0x243f6a8885a308d3ll, 0x13198a2e03707344ll);
+        __m128i lane0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+        __m128i lane1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 16));
+        __m128i lane2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 32));
+        __m128i lane3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 48));
+        __m128i low = _mm_aesenc_si128(_mm_xor_si128(lane0, round_key), lane1);
+        __m128i high = _mm_aesenc_si128(_mm_xor_si128(lane2, round_key), lane3);
+        __m128i state = _mm_aesenc_si128(low, high);
+        state = _mm_aesenc_si128(state, round_key);
+        state = _mm_aesenc_si128(state, round_key);
+        return static_cast<uint64_t>(_mm_cvtsi128_si64(state)) ^ static_cast<uint64_t>(high_half(state));
+    }
+
+    // four independent crc lanes keep the crc32 units busy, a multiply mixes the 128 bits back together
+    __attribute__((target("sse4.2"))) static uint64_t hash_crc32c(const char* key) {
+        uint64_t crc0 = 0x243f6a88, crc1 = 0x85a308d3, crc2 = 0x13198a2e, crc3 = 0x03707344;
+        crc0 = _mm_crc32_u64(crc0, read8(key));
+        crc1 = _mm_crc32_u64(crc1, read8(key + 8));
+        crc2 = _mm_crc32_u64(crc2, read8(key + 16));
+        crc3 = _mm_crc32_u64(crc3, read8(key + 24));
+        crc0 = _mm_crc32_u64(crc0, read8(key + 32));
+        crc1 = _mm_crc32_u64(crc1, read8(key + 40));
+        crc2 = _mm_crc32_u64(crc2, read8(key + 48));
+        crc3 = _mm_crc32_u64(crc3, read8(key + 56));
+        return mix((crc0 | crc1 << 32) ^ 0xa0761d6478bd642full, (crc2 | crc3 << 32) ^ 0xe7037ed1a0b428dbull);
+    }
+#endif
+
+private:
+    using hash_function = uint64_t (*)(const char*);
+
+    static hash_function kernel() {
+        static const hash_function selected = select_kernel();
+        return selected;
+    }
+
+    static hash_function select_kernel() {
+#ifdef DDAOF_FIXED64_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("aes")) {
+            return &hash_aes;
+        } else if (__builtin_cpu_supports("sse4.2")) {
+            return &hash_crc32c;
+        }
+#endif
+        return &hash_portable;
+    }
+
+#ifdef DDAOF_FIXED64_X86
+    // _mm_extract_epi64 needs SSE4.1, an unpack reaches the high half with plain SSE2
+    __attribute__((target("sse2"))) static int64_t high_half(__m128i value) {
+        return _mm_cvtsi128_si64(_mm_unpackhi_epi64(value, value));
+    }
+#endif
+
+    static uint64_t mix(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__)
+        unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+        uint64_t lhs_lo = lhs & 0xffffffff, lhs_hi = lhs >> 32;
+        uint64_t rhs_lo = rhs & 0xffffffff, rhs_hi = rhs >> 32;
+        uint64_t lo_lo = lhs_lo * rhs_lo, hi_lo = lhs_hi * rhs_lo;
+        uint64_t lo_hi = lhs_lo * rhs_hi, hi_hi = lhs_hi * rhs_hi;
+        uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+        return ((cross << 32) | (lo_lo & 0xffffffff)) ^ ((hi_lo >> 32) + (cross >> 32) + hi_hi);
+#endif
+    }
+
+    static uint64_t read8(const char* p) {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+};
+
+} // end namespace ddaof
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <functional>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "fixed64_hash.hpp"
+#include "seeded_string_hash.hpp"
+
+namespace ddaof {
+
+/**
+ * A string of exactly N bytes stored inline, for keys that always have the same length.
+ * A std::string key costs a 32-byte header, a heap allocation and a pointer chase on every probe,
+ * a fixed_string<64> sits directly in faster_table_entry and compares with two AVX2 loads per side
+ * (four with SSE2). Shorter input is zero padded, longer input is rejected.
+ * std::hash is specialized, so ddaof::flat_hash_map<ddaof::fixed_string<64>, V> works as is.
+ * The bytes are not aligned on purpose: alignas(32) would double the entry size for a 64-byte key.
+*/
+template<size_t N>
+class fixed_string {
+public:
+    static_assert(N > 0, "fixed_string needs at least one byte");
+
+    fixed_string() : _data() {}
+
+    fixed_string(const char* str, size_t length) : _data() {
+        if (length > N) {
+            throw std::length_error("fixed_string input is longer than its capacity.");
+        }
+        memcpy(_data, str, length);
+    }
+
+    explicit fixed_string(const std::string& str)
+            : fixed_string(str.data(), str.size()) {}
+
+    const char* data() const {
+        return _data;
+    }
+
+    static constexpr size_t size() {
+        return N;
+    }
+
+    std::string str() const {
+        return std::string(_data, N);
+    }
+
+    friend bool operator==(const fixed_string& lhs, const fixed_string& rhs) {
+        return bytes_equal(lhs._data, rhs._data);
+    }
+
+    friend bool operator!=(const fixed_string& lhs, const fixed_string& rhs) {
+        return !(lhs == rhs);
+    }
+
+private:
+    char _data[N];
+
+    // xor every chunk and or the differences together, one branch for the whole key
+    static bool bytes_equal(const char* lhs, const char* rhs) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        if (N >= 32) {
+            __m256i diff = _mm256_setzero_si256();
+            for (; i + 32 <= N; i += 32) {
+                __m256i left = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+                __m256i right = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+                diff = _mm256_or_si256(diff, _mm256_xor_si256(left, right));
+            }
+            if (!_mm256_testz_si256(diff, diff)) {
+                return false;
+            }
+        }
+#elif defined(__SSE2__)
+        if (N >= 16) {
+            __m128i diff = _mm_setzero_si128();
+            for (; i + 16 <= N; i += 16) {
+                __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i));
+                __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + i));
+                diff = _mm_or_si128(diff, _mm_xor_si128(left, right));
+            }
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xffff) {
+                return false;
+            }
+        }
+#endif
+        return memcmp(lhs + i, rhs + i, N - i) == 0;
+    }
+};
+
+// 64-byte keys go through fixed64_hash, every other length through the wyhash construction with a fixed seed
+struct fixed_string_hash {
+    typedef std::true_type is_avalanching;
+
+    template<size_t N>
+    size_t operator()(const fixed_string<N>& key) const {
+        return hash_bytes(key.data(), std::integral_constant<bool, N == fixed64_hash::key_length>(), N);
+    }
+
+private:
+    static size_t hash_bytes(const char* data, std::true_type, size_t) {
+        return fixed64_hash::hash(data);
+    }
+
+    static size_t hash_bytes(const char* data, std::false_type, size_t length) {
+        return seeded_string_hash::hash(data, length, 0);
+    }
+};
+
+} // end namespace ddaof
+
+namespace std {
+
+template<size_t N>
+struct hash<ddaof::fixed_string<N>> : ddaof::fixed_string_hash {};
+
+} // end namespace std
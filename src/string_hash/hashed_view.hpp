@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <string_view>
+#include <type_traits>
+
+#include "seeded_string_hash.hpp"
+
+namespace ddaof {
+
+// a view with its hash computed once, like string_with_hash, so growing an index never rereads the bytes
+struct hashed_view {
+    std::string_view str;
+    uint64_t hash;
+
+    static hashed_view of(std::string_view str) {
+        return { str, seeded_string_hash::hash(str.data(), str.size(), 0) };
+    }
+
+    struct hasher {
+        typedef std::true_type is_avalanching;
+
+        size_t operator()(const hashed_view& key) const {
+            return key.hash;
+        }
+    };
+
+    friend bool operator==(const hashed_view& lhs, const hashed_view& rhs) {
+        return lhs.hash == rhs.hash && lhs.str == rhs.str;
+    }
+
+    friend bool operator!=(const hashed_view& lhs, const hashed_view& rhs) {
+        return !(lhs == rhs);
+    }
+};
+
+} // end namespace ddaof
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+#include "fixed_string.hpp"
+#include "seeded_string_hash.hpp"
+
+namespace ddaof {
+
+/**
+ * A paired hasher and comparator that only look at the bytes [Offset, Offset + Length) of a key,
+ * for structured keys whose other bytes are the same for every key, like the "AAACPGC" prefix and
+ * "VVQTYPXX" suffix around the 49 random bytes that src/random_string_generator.cpp writes.
+ * Both use the same window, so keys that compare equal always hash equal:
+ *
+ *     ddaof::flat_hash_map<std::string, int, ddaof::key_region<7, 49>::hash, ddaof::key_region<7, 49>::equal> map;
+ *
+ * Keys too short to hold the window are hashed and compared whole, keys of different length never compare equal.
+ * The bytes outside the window are not checked, every key in the table has to share them.
+ * The window is compared with full-width loads: whole vectors first, then one vector that overlaps
+ * the previous one and ends exactly at the end of the window, so no masked load and no byte tail.
+*/
+template<size_t Offset, size_t Length>
+struct key_region {
+    static_assert(Length > 0, "key_region needs at least one byte");
+
+    static constexpr size_t end = Offset + Length;
+
+    struct hash {
+        typedef std::true_type is_avalanching;
+
+        size_t operator()(const std::string& key) const {
+            if (key.size() < end) {
+                return seeded_string_hash::hash(key.data(), key.size(), 0);
+            }
+            return seeded_string_hash::hash(key.data() + Offset, Length, 0);
+        }
+
+        template<size_t N>
+        size_t operator()(const fixed_string<N>& key) const {
+            static_assert(end <= N, "key_region does not fit in the fixed_string");
+            return seeded_string_hash::hash(key.data() + Offset, Length, 0);
+        }
+    };
+
+    struct equal {
+        bool operator()(const std::string& lhs, const std::string& rhs) const {
+            if (lhs.size() != rhs.size()) {
+                return false;
+            } else if (lhs.size() < end) {
+                return lhs == rhs;
+            }
+            return window_equal(lhs.data() + Offset, rhs.data() + Offset);
+        }
+
+        template<size_t N>
+        bool operator()(const fixed_string<N>& lhs, const fixed_string<N>& rhs) const {
+            static_assert(end <= N, "key_region does not fit in the fixed_string");
+            return window_equal(lhs.data() + Offset, rhs.data() + Offset);
+        }
+    };
+
+    static bool window_equal(const char* lhs, const char* rhs) {
+#if defined(__AVX2__)
+        if (Length >= 32) {
+            __m256i diff = _mm256_setzero_si256();
+            for (size_t i = 0; i + 32 <= Length; i += 32) {
+                diff = _mm256_or_si256(diff, xor256(lhs + i, rhs + i));
+            }
+            diff = _mm256_or_si256(diff, xor256(lhs + Length - 32, rhs + Length - 32));
+            return _mm256_testz_si256(diff, diff) != 0;
+        }
+#endif
+#if defined(__SSE2__)
+        if (Length >= 16) {
+            __m128i diff = _mm_setzero_si128();
+            for (size_t i = 0; i + 16 <= Length; i += 16) {
+                diff = _mm_or_si128(diff, xor128(lhs + i, rhs + i));
+            }
+            diff = _mm_or_si128(diff, xor128(lhs + Length - 16, rhs + Length - 16));
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xffff;
+        }
+#endif
+        return memcmp(lhs, rhs, Length) == 0;
+    }
+
+private:
+#if defined(__AVX2__)
+    static __m256i xor256(const char* lhs, const char* rhs) {
+        return _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs)),
+                                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs)));
+    }
+#endif
+#if defined(__SSE2__)
+    static __m128i xor128(const char* lhs, const char* rhs) {
+        return _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs)),
+                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs)));
+    }
+#endif
+};
+
+// the layout of the test data: 7-byte prefix, 49 variable bytes, 8-byte suffix
+using structured_key_region = key_region<7, 49>;
+
+} // end namespace ddaof
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <chrono>
+#include <random>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+namespace ddaof {
+
+/**
+ * A seeded string hasher for keys that come from clients, built on the wyhash construction:
+ * 16 bytes per 64x64->128 bit multiply, so it is about as fast as CityHash64 but its output
+ * depends on a secret seed, which makes precomputed collision sets useless.
+ * Every instance starts from a seed that is drawn once per process; reseed() draws a fresh one.
+ * faster_hashtable notices the reseed() member and, when probe chains overflow at a low load factor,
+ * rehashes once with a new seed instead of doubling the bucket array.
+*/
+class seeded_string_hash {
+public:
+    typedef std::true_type is_avalanching;
+
+    seeded_string_hash() : _seed(process_seed()) {}
+    explicit seeded_string_hash(uint64_t seed) : _seed(seed) {}
+
+    size_t operator()(const std::string& str) const {
+        return hash(str.data(), str.size(), _seed);
+    }
+
+    size_t operator()(const char* str) const {
+        return hash(str, strlen(str), _seed);
+    }
+
+    void reseed() {
+        _seed = random_seed();
+    }
+
+    void reseed(uint64_t seed) {
+        _seed = seed;
+    }
+
+    uint64_t seed() const {
+        return _seed;
+    }
+
+    static uint64_t hash(const char* data, size_t length, uint64_t seed) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+        seed ^= mix(seed ^ _secret0, _secret1);
+        uint64_t a, b;
+        if (length <= 16) {
+            if (length >= 4) {
+                a = (read4(p) << 32) | read4(p + ((length >> 3) << 2));
+                b = (read4(p + length - 4) << 32) | read4(p + length - 4 - ((length >> 3) << 2));
+            } else if (length > 0) {
+                a = (uint64_t(p[0]) << 16) | (uint64_t(p[length >> 1]) << 8) | p[length - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            size_t remaining = length;
+            if (remaining > 48) {
+                uint64_t seed1 = seed, seed2 = seed;
+                do {
+                    seed = mix(read8(p) ^ _secret1, read8(p + 8) ^ seed);
+                    seed1 = mix(read8(p + 16) ^ _secret2, read8(p + 24) ^ seed1);
+                    seed2 = mix(read8(p + 32) ^ _secret3, read8(p + 40) ^ seed2);
+                    p += 48;
+                    remaining -= 48;
+                } while (remaining > 48);
+                seed ^= seed1 ^ seed2;
+            }
+            while (remaining > 16) {
+                seed = mix(read8(p) ^ _secret1, read8(p + 8) ^ seed);
+                p += 16;
+                remaining -= 16;
+            }
+            a = read8(p + remaining - 16);
+            b = read8(p + remaining - 8);
+        }
+        a ^= _secret1;
+        b ^= seed;
+        multiply(a, b);
+        return mix(a ^ _secret0 ^ length, b ^ _secret1);
+    }
+
+    static uint64_t random_seed() {
+        std::random_device device;
+        uint64_t seed = (uint64_t(device()) << 32) ^ device();
+        return seed ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+
+private:
+    uint64_t _seed;
+
+    static constexpr uint64_t _secret0 = 0xa0761d6478bd642full;
+    static constexpr uint64_t _secret1 = 0xe7037ed1a0b428dbull;
+    static constexpr uint64_t _secret2 = 0x8ebc6af09c88c6e3ull;
+    static constexpr uint64_t _secret3 = 0x589965cc75374cc3ull;
+
+    static uint64_t process_seed() {
+        static const uint64_t seed = random_seed();
+        return seed;
+    }
+
+    // lhs and rhs become the low and high half of their 128-bit product
+    static void multiply(uint64_t& lhs, uint64_t& rhs) {
+#if defined(__SIZEOF_INT128__)
+        unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+        lhs = static_cast<uint64_t>(product);
+        rhs = static_cast<uint64_t>(product >> 64);
+#else
+        uint64_t lhs_lo = lhs & 0xffffffff, lhs_hi = lhs >> 32;
+        uint64_t rhs_lo = rhs & 0xffffffff, rhs_hi = rhs >> 32;
+        uint64_t lo_lo = lhs_lo * rhs_lo, hi_lo = lhs_hi * rhs_lo;
+        uint64_t lo_hi = lhs_lo * rhs_hi, hi_hi = lhs_hi * rhs_hi;
+        uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+        lhs = (cross << 32) | (lo_lo & 0xffffffff);
+        rhs = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+#endif
+    }
+
+    static uint64_t mix(uint64_t lhs, uint64_t rhs) {
+        multiply(lhs, rhs);
+        return lhs ^ rhs;
+    }
+
+    static uint64_t read8(const uint8_t* p) {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint64_t read4(const uint8_t* p) {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+};
+
+} // end namespace ddaof
@@ -1,28 +1,141 @@
 #pragma once
 
+#include <algorithm>
 #include <stdint.h>
+#include <string.h>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "city.h"
+#include "key_region.hpp"
 
 namespace ddaof {
 
 constexpr size_t STR_STABLE_LENGTH = 64;
 
+/**
+ * Remembers CityHash64(str, STR_STABLE_LENGTH) for recently seen strings, so a stream where keys repeat
+ * (35% immediate repeats plus warm keys in the random_string_generator.cpp data) hashes each key once.
+ * It is a set-associative cache: a cheap pre-hash of three words from the middle of the key picks a set
+ * of four ways, a 32-bit tag and the length filter the ways, and a vector compare of the stored bytes
+ * confirms the hit. A miss replaces the ways of a set round robin.
+ * The hash only depends on the first STR_STABLE_LENGTH bytes, so longer keys are cached by that prefix.
+ * 1024 sets of 4 ways keep about 300KB of keys, roughly an L2; pass another set count to the constructor.
+*/
 class string_hash_cache {
 public:
-    bool get_hash(const std::string& input_str) {
-        if (_str != input_str) {
-            _hash = CityHash64(input_str.c_str(), STR_STABLE_LENGTH);
-            _str = input_str;
-        } 
-        return _hash;
+    static constexpr size_t ways = 4;
+
+    explicit string_hash_cache(size_t num_sets = 1024)
+            : _sets(round_up_to_power_of_two(num_sets)), _set_mask(_sets.size() - 1) {}
+
+    uint64_t get_hash(const std::string& input_str) {
+        return get_hash(input_str.data(), input_str.size());
+    }
+
+    uint64_t get_hash(const char* data, size_t length) {
+        length = std::min(length, STR_STABLE_LENGTH);
+        uint64_t pre_hash = cheap_hash(data, length);
+        cache_set& set = _sets[pre_hash & _set_mask];
+        uint32_t tag = static_cast<uint32_t>(pre_hash >> 32) | 1; // 0 marks an empty way
+
+        for (size_t way = 0; way < ways; ++way) {
+            if (set.tags[way] == tag && set.lengths[way] == length && keys_equal(set.keys[way], data, length)) {
+                ++_hits;
+                return set.hashes[way];
+            }
+        }
+
+        ++_misses;
+        uint64_t hash = CityHash64(data, length);
+        size_t victim = set.next_victim;
+        set.next_victim = static_cast<uint8_t>((victim + 1) % ways);
+        set.tags[victim] = tag;
+        set.lengths[victim] = static_cast<uint8_t>(length);
+        set.hashes[victim] = hash;
+        memcpy(set.keys[victim], data, length);
+        return hash;
+    }
+
+    void clear() {
+        std::fill(_sets.begin(), _sets.end(), cache_set());
+        _hits = 0;
+        _misses = 0;
+    }
+
+    size_t num_sets() const {
+        return _sets.size();
+    }
+
+    uint64_t hits() const {
+        return _hits;
+    }
+
+    uint64_t misses() const {
+        return _misses;
     }
 
 private:
-    std::string _str;
-    uint64_t _hash;
+    // tags, lengths and hashes share the first cache line, the keys follow
+    struct alignas(64) cache_set {
+        uint32_t tags[ways] = {};
+        uint8_t lengths[ways] = {};
+        uint8_t next_victim = 0;
+        uint64_t hashes[ways] = {};
+        char keys[ways][STR_STABLE_LENGTH];
+    };
+
+    std::vector<cache_set> _sets;
+    size_t _set_mask;
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+
+    static size_t round_up_to_power_of_two(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static bool keys_equal(const char* stored, const char* data, size_t length) {
+        if (length == STR_STABLE_LENGTH) {
+            return key_region<0, STR_STABLE_LENGTH>::window_equal(stored, data);
+        }
+        return memcmp(stored, data, length) == 0;
+    }
+
+    // structured keys share their first and last bytes, so the words come from the middle
+    static uint64_t cheap_hash(const char* data, size_t length) {
+        uint64_t a, b, c;
+        if (length >= 16) {
+            a = read8(data + length / 4);
+            b = read8(data + length / 2);
+            c = read8(data + length - 8 - length / 8);
+        } else if (length >= 8) {
+            a = read8(data);
+            b = read8(data + length - 8);
+            c = 0;
+        } else {
+            a = b = c = 0;
+            memcpy(&a, data, length);
+        }
+        uint64_t h = (a * 0x9E3779B97F4A7C15ull) ^ rotate((b * 0xC2B2AE3D27D4EB4Full), 31) ^ (c * 0x165667B19E3779F9ull) ^ length;
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+        return h ^ (h >> 32);
+    }
+
+    static uint64_t rotate(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    static uint64_t read8(const char* p) {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
 };
 
-} // end namespace ddaof
\ No newline at end of file
+} // end namespace ddaof
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "../flat_hash_map/faster_hashtable.hpp"
+#include "hashed_view.hpp"
+
+namespace ddaof {
+
+/**
+ * Maps strings to dense 32-bit IDs, 0, 1, 2, ... in the order they were first interned, and back.
+ * Every distinct string is copied once into an arena and never moves, so view(id) stays valid for the
+ * lifetime of the interner, and maps that key on the ID instead of the string get 4-byte keys and
+ * integer compares.
+ *
+ * The index is split into 16 shards picked by the top bits of the hash, each a flat_hash_map behind
+ * a shared_mutex: interning a string that is already known takes only a shared lock, a new string takes
+ * its shard's exclusive lock. view(id) takes no lock at all, the ID directory is a list of chunks
+ * that double in size and never move once published.
+*/
+class string_interner {
+    static constexpr size_t num_shards = 16;
+    static constexpr size_t arena_block_size = 64 * 1024;
+    static constexpr size_t first_chunk_bits = 10;
+    static constexpr size_t num_chunks = 33 - first_chunk_bits; // enough chunks for every uint32_t ID
+
+    struct alignas(64) shard {
+        mutable std::shared_mutex mutex;
+        ddaof::flat_hash_map<hashed_view, uint32_t, hashed_view::hasher> index;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char* cursor = nullptr;
+        size_t remaining = 0;
+        size_t arena_bytes = 0;
+    };
+
+public:
+    static constexpr uint32_t npos = ~uint32_t(0);
+
+    string_interner() = default;
+
+    // hands out at most max_size IDs, intern() throws std::length_error after that
+    explicit string_interner(uint32_t max_size)
+            : _max_size(max_size) {}
+
+    string_interner(const string_interner&) = delete;
+    string_interner& operator=(const string_interner&) = delete;
+
+    ~string_interner() {
+        for (std::atomic<std::string_view*>& chunk : _chunks) {
+            delete[] chunk.load(std::memory_order_acquire);
+        }
+    }
+
+    uint32_t intern(std::string_view str) {
+        hashed_view key = hashed_view::of(str);
+        shard& target = shard_for(key.hash);
+        {
+            std::shared_lock<std::shared_mutex> lock(target.mutex);
+            auto found = target.index.find(key);
+            if (found != target.index.end()) {
+                return found->second;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(target.mutex);
+        auto found = target.index.find(key);
+        if (found != target.index.end()) {
+            return found->second;
+        }
+        uint32_t id = reserve_id();
+        key.str = copy_to_arena(target, str);
+        directory_slot(id) = key.str;
+        target.index.emplace(key, id);
+        return id;
+    }
+
+    // npos when the string was never interned
+    uint32_t find(std::string_view str) const {
+        hashed_view key = hashed_view::of(str);
+        const shard& target = shard_for(key.hash);
+        std::shared_lock<std::shared_mutex> lock(target.mutex);
+        auto found = target.index.find(key);
+        return found == target.index.end() ? npos : found->second;
+    }
+
+    // id has to come from intern() or find() on this interner
+    std::string_view view(uint32_t id) const {
+        size_t chunk, offset;
+        locate(id, chunk, offset);
+        return _chunks[chunk].load(std::memory_order_acquire)[offset];
+    }
+
+    size_t size() const {
+        return _next_id.load(std::memory_order_relaxed);
+    }
+
+    // arena blocks, the shard indexes and the ID directory
+    size_t memory_usage() const {
+        size_t result = 0;
+        for (const shard& current : _shards) {
+            std::shared_lock<std::shared_mutex> lock(current.mutex);
+            result += current.arena_bytes + current.index.memory_usage()
+                      + current.blocks.capacity() * sizeof(std::unique_ptr<char[]>);
+        }
+        for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+            if (_chunks[chunk].load(std::memory_order_acquire)) {
+                result += (size_t(1) << (chunk + first_chunk_bits)) * sizeof(std::string_view);
+            }
+        }
+        return result;
+    }
+
+private:
+    shard _shards[num_shards];
+    std::atomic<uint32_t> _next_id{ 0 };
+    uint32_t _max_size = npos; // npos itself is never an ID
+    std::atomic<std::string_view*> _chunks[num_chunks] = {};
+
+    shard& shard_for(uint64_t hash) {
+        return _shards[hash >> 60];
+    }
+
+    const shard& shard_for(uint64_t hash) const {
+        return _shards[hash >> 60];
+    }
+
+    // the check and the increment are one step, so concurrent interns can never take the counter past _max_size
+    uint32_t reserve_id() {
+        uint32_t id = _next_id.load(std::memory_order_relaxed);
+        do {
+            if (id >= _max_size) {
+                throw std::length_error("string_interner ran out of IDs.");
+            }
+        } while (!_next_id.compare_exchange_weak(id, id + 1, std::memory_order_relaxed));
+        return id;
+    }
+
+    // chunk k holds the IDs [2^(k + first_chunk_bits) - 2^first_chunk_bits, 2^(k + first_chunk_bits + 1) - 2^first_chunk_bits)
+    static void locate(uint32_t id, size_t& chunk, size_t& offset) {
+        uint64_t biased = uint64_t(id) + (uint64_t(1) << first_chunk_bits);
+        size_t top_bit = static_cast<size_t>(ddaof::log2(static_cast<size_t>(biased)));
+        chunk = top_bit - first_chunk_bits;
+        offset = static_cast<size_t>(biased - (uint64_t(1) << top_bit));
+    }
+
+    std::string_view& directory_slot(uint32_t id) {
+        size_t chunk, offset;
+        locate(id, chunk, offset);
+        std::string_view* entries = _chunks[chunk].load(std::memory_order_acquire);
+        if (!entries) {
+            entries = allocate_chunk(chunk);
+        }
+        return entries[offset];
+    }
+
+    DDAOF_NOINLINE(std::string_view*) allocate_chunk(size_t chunk) {
+        std::string_view* entries = new std::string_view[size_t(1) << (chunk + first_chunk_bits)];
+        std::string_view* expected = nullptr;
+        if (!_chunks[chunk].compare_exchange_strong(expected, entries, std::memory_order_acq_rel)) {
+            delete[] entries;
+            return expected;
+        }
+        return entries;
+    }
+
+    // called with the shard's exclusive lock held
+    static std::string_view copy_to_arena(shard& target, std::string_view str) {
+        if (str.empty()) {
+            return std::string_view();
+        } else if (str.size() > target.remaining) {
+            size_t block_size = str.size() > arena_block_size / 4 ? str.size() : arena_block_size;
+            target.blocks.emplace_back(new char[block_size]);
+            target.arena_bytes += block_size;
+            if (block_size != arena_block_size) {
+                // an oversized string gets a block of its own, the current block keeps filling
+                memcpy(target.blocks.back().get(), str.data(), str.size());
+                return std::string_view(target.blocks.back().get(), str.size());
+            }
+            target.cursor = target.blocks.back().get();
+            target.remaining = block_size;
+        }
+        char* destination = target.cursor;
+        memcpy(destination, str.data(), str.size());
+        target.cursor += str.size();
+        target.remaining -= str.size();
+        return std::string_view(destination, str.size());
+    }
+};
+
+} // end namespace ddaof
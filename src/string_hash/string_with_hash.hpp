@@ -17,14 +17,18 @@ public:
         _hash_value = CityHash64(str.c_str(), ddaof::STR_STABLE_LENGTH);
     }
     string_with_hash(std::string&& str) : _str(std::move(str)) {
-        _hash_value = CityHash64(str.c_str(), ddaof::STR_STABLE_LENGTH);
+        _hash_value = CityHash64(_str.c_str(), ddaof::STR_STABLE_LENGTH);
     }
 
     string_with_hash(const string_with_hash& other) : 
-            _hash_value(other._hash_value), _str(other._str) {}
+            _str(other._str), _hash_value(other._hash_value) {}
 
     string_with_hash(string_with_hash&& other) : 
-            _hash_value(std::move(other._hash_value)), _str(std::move(other.str())) {}
+            _str(std::move(other._str)), _hash_value(other._hash_value) {}
+
+    // flat_hash_map swaps its elements while inserting
+    string_with_hash& operator=(const string_with_hash& other) = default;
+    string_with_hash& operator=(string_with_hash&& other) = default;
 
     friend bool operator==(const string_with_hash& lhs, const string_with_hash& rhs) {
         if (lhs.hash() != rhs.hash()) {
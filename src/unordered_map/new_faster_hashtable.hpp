@@ -23,7 +23,7 @@ struct power_of_two_hash_policy;
 struct prime_number_hash_policy;
 
 template<typename Result, typename Functor>
-struct function_wrapper {
+struct function_wrapper : Functor {
     function_wrapper() = default;
     function_wrapper(const Functor& funtor) : Functor(funtor) {}
 
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "new_faster_hashtable.hpp"
+#include "../flat_hash_map/owned_heap_bytes.hpp"
 
+#include <functional>
+#include <stdexcept>
 #include <type_traits>
+#include <vector>
 
 namespace ddaof {
 template<typename T, typename Allocator>
@@ -27,13 +31,27 @@ using ddaof::key_or_value_equality;
 using ddaof::assign_if_true;
 using ddaof::HashPolicySelector;
 
+/**
+ * A snapshot of the chains of a sherwood_v10_table, returned by sherwood_v10_table::stats().
+ * chain_length_histogram[n] counts the buckets that hold n elements.
+*/
+struct chain_stats {
+    std::vector<size_t> chain_length_histogram;
+    double mean_chain_length = 0; // over the buckets that hold at least one element
+    size_t max_chain_length = 0;
+    size_t empty_buckets = 0;
+    size_t used_buckets = 0;
+    size_t buckets_scanned = 0;
+    float load_factor = 0;
+};
+
 template<typename T, typename FindKey, 
          typename ArgumentHash, typename Hasher, 
          typename ArgumentEqual, typename Equal, 
          typename ArgumentAlloc, typename EntryAlloc, 
          typename BucketAllocator>
 class sherwood_v10_table : private EntryAlloc, private Hasher, private Equal, private BucketAllocator {
-    using Entry = ddaof::faster_table_entry<T>;
+    using Entry = sherwood_v10_entry<T, ArgumentAlloc>;
     using AllocatorTraits = std::allocator_traits<EntryAlloc>;
     using BucketAllocatorTraits = std::allocator_traits<BucketAllocator>;
     using EntryPointer = typename AllocatorTraits::pointer;
@@ -522,9 +540,64 @@ public:
         return num_elements == 0;
     }
 
+    // bytes of the bucket array and of the nodes
+    size_t memory_usage() const {
+        if (entries == Entry::empty_pointer()) {
+            return 0;
+        }
+        return (num_slots_minus_one + 2) * sizeof(EntryPointer) + num_elements * sizeof(Entry);
+    }
+
+    // memory_usage() plus the heap memory owned by the elements, see owned_heap_bytes, O(size())
+    size_t deep_memory_usage() const {
+        size_t result = memory_usage();
+        for (const T& value : *this) {
+            result += owned_heap_bytes_of(value);
+        }
+        return result;
+    }
+
+    // walks every bucket and chain, O(bucket_count() + size())
+    chain_stats stats() const {
+        return stats(bucket_count());
+    }
+
+    // follows the chains of num_samples evenly spaced buckets
+    chain_stats stats(size_t num_samples) const {
+        chain_stats result;
+        result.load_factor = load_factor();
+        size_t num_buckets = bucket_count();
+        if (num_samples == 0 || num_samples > num_buckets) {
+            num_samples = num_buckets;
+        }
+        size_t stride = num_buckets / num_samples;
+        for (size_t index = 0; result.buckets_scanned < num_samples; index += stride) {
+            size_t length = 0;
+            for (EntryPointer it = entries[index]; it; it = it->next) {
+                ++length;
+            }
+            if (length >= result.chain_length_histogram.size()) {
+                result.chain_length_histogram.resize(length + 1);
+            }
+            ++result.chain_length_histogram[length];
+            ++result.buckets_scanned;
+            if (length) {
+                ++result.used_buckets;
+                result.mean_chain_length += length;
+                result.max_chain_length = std::max(result.max_chain_length, length);
+            } else {
+                ++result.empty_buckets;
+            }
+        }
+        if (result.used_buckets) {
+            result.mean_chain_length /= result.used_buckets;
+        }
+        return result;
+    }
+
 
 private:
-    EntryPointer* entries = Entry::empty_default_table();
+    EntryPointer* entries = Entry::empty_pointer();
     size_t num_slots_minus_one = 0;
     typename HashPolicySelector<ArgumentHash>::type hash_policy;
     float _max_load_factor = 1.0f;
@@ -631,4 +704,65 @@ private:
         }
     };
 };
+
+template<typename K, typename V, typename H = std::hash<K>, typename E = std::equal_to<K>, typename A = std::allocator<std::pair<K, V> > >
+class unordered_map
+        : public ddaof::sherwood_v10_table <
+            std::pair<K, V>,
+            K,
+            H,
+            ddaof::key_or_value_hasher<K, std::pair<K, V>, H>,
+            E,
+            ddaof::key_or_value_equality<K, std::pair<K, V>, E>,
+            A,
+            typename std::allocator_traits<A>::template rebind_alloc<ddaof::sherwood_v10_entry<std::pair<K, V>, A>>,
+            typename std::allocator_traits<A>::template rebind_alloc<typename ddaof::sherwood_v10_entry<std::pair<K, V>, A>::EntryPointer>> {
+    using Table = ddaof::sherwood_v10_table
+    <
+        std::pair<K, V>,
+        K,
+        H,
+        ddaof::key_or_value_hasher<K, std::pair<K, V>, H>,
+        E,
+        ddaof::key_or_value_equality<K, std::pair<K, V>, E>,
+        A,
+        typename std::allocator_traits<A>::template rebind_alloc<ddaof::sherwood_v10_entry<std::pair<K, V>, A>>,
+        typename std::allocator_traits<A>::template rebind_alloc<typename ddaof::sherwood_v10_entry<std::pair<K, V>, A>::EntryPointer>
+    >;
+public:
+    using key_type = K;
+    using mapped_type = V;
+
+    using Table::Table;
+    unordered_map() {}
+
+    V& operator[](const K& key) {
+        return this->emplace(key, convertible_to_value()).first->second;
+    }
+
+    V& operator[](K&& key) {
+        return this->emplace(std::move(key), convertible_to_value()).first->second;
+    }
+
+    V& at(const K& key) {
+        auto found = this->find(key);
+        if (found == this->end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+    const V& at(const K& key) const {
+        auto found = this->find(key);
+        if (found == this->end())
+            throw std::out_of_range("Argument passed to at() was not in the map.");
+        return found->second;
+    }
+
+private:
+    struct convertible_to_value {
+        operator V() const {
+            return V();
+        }
+    };
+};
 } // end namespace ddaof
\ No newline at end of file
@@ -0,0 +1,119 @@
+// Behavioral tests for affix_compact_map.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/flat_hash_map affix_compact_map_test.cpp
+//     ./a.out
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "affix_compact_map.hpp"
+#include "check.hpp"
+
+// the layout of src/random_string_generator.cpp: 7-byte prefix, 49 variable bytes, 8-byte suffix
+std::string structured_key(int i) {
+    std::string middle = std::to_string(i * 7919) + "-";
+    while (middle.size() < 49) {
+        middle += static_cast<char>('a' + (middle.size() * 31 + i) % 26);
+    }
+    return "AAACPGC" + middle + "VVQTYPXX";
+}
+
+typedef ddaof::affix_compact_map<int> structured_map;
+typedef ddaof::affix_layout<7, 49, 8> structured_layout;
+
+void test_only_the_middle_is_stored() {
+    static_assert(structured_map::key_length == 64, "7 + 49 + 8 bytes");
+    static_assert(sizeof(structured_map::compact_key_type) == 49, "only the middle is stored");
+
+    structured_map map("AAACPGC", "VVQTYPXX");
+    std::string key = structured_key(1);
+    structured_map::compact_key_type compact = map.compact(key);
+    CHECK(std::string(compact.data(), 49) == key.substr(7, 49));
+    CHECK(map.full_key(compact) == key);
+    // a full key and its compact form have to land in the same bucket
+    CHECK(structured_layout::hash()(key) == structured_layout::hash()(compact));
+}
+
+void test_insert_find_erase() {
+    structured_map map("AAACPGC", "VVQTYPXX");
+    CHECK(map.prefix() == "AAACPGC");
+    CHECK(map.suffix() == "VVQTYPXX");
+    for (int i = 0; i < 1000; ++i) {
+        CHECK(map.emplace(structured_key(i), i).second);
+    }
+    CHECK(!map.emplace(structured_key(5), -5).second);
+    CHECK(map.size() == 1000);
+    for (int i = 0; i < 1000; ++i) {
+        auto found = map.find(structured_key(i));
+        CHECK(found != map.end() && found->second == i);
+        CHECK(found != map.end() && map.full_key(*found) == structured_key(i));
+    }
+    CHECK(map.at(structured_key(7)) == 7);
+    map[structured_key(7)] = 70;
+    CHECK(map.at(structured_key(7)) == 70);
+    CHECK(!map.insert_or_assign(structured_key(8), 80).second);
+    CHECK(map.at(structured_key(8)) == 80);
+
+    size_t visited = 0;
+    for (const auto& entry : map) {
+        CHECK(map.count(map.full_key(entry)) == 1);
+        ++visited;
+    }
+    CHECK(visited == 1000);
+
+    CHECK(map.erase(structured_key(3)) == 1);
+    CHECK(map.erase(structured_key(3)) == 0);
+    CHECK(map.find(structured_key(3)) == map.end());
+    CHECK_THROWS(map.at(structured_key(3)), std::out_of_range);
+    CHECK(map.size() == 999);
+
+    structured_map copy(map);
+    CHECK(copy.size() == 999);
+    CHECK(copy.at(structured_key(999)) == 999);
+    CHECK(copy.prefix() == "AAACPGC");
+}
+
+void test_foreign_keys() {
+    structured_map map("AAACPGC", "VVQTYPXX");
+    map[structured_key(1)] = 1;
+
+    std::string other_prefix = structured_key(1);
+    other_prefix[0] = 'B';
+    std::string other_suffix = structured_key(1);
+    other_suffix.back() = 'Y';
+    std::string too_short = structured_key(1).substr(0, 63);
+
+    // lookups just miss, inserts refuse the key
+    CHECK(map.find(other_prefix) == map.end());
+    CHECK(map.find(other_suffix) == map.end());
+    CHECK(map.find(too_short) == map.end());
+    CHECK(map.find("") == map.end());
+    CHECK_THROWS(map.emplace(other_prefix, 2), std::invalid_argument);
+    CHECK_THROWS(map[other_suffix], std::invalid_argument);
+    CHECK_THROWS(map.emplace(too_short, 2), std::invalid_argument);
+    CHECK(map.size() == 1);
+
+    CHECK_THROWS(structured_map("AAACPG", "VVQTYPXX"), std::invalid_argument);
+    CHECK_THROWS(structured_map("AAACPGC", "VVQTYPXXX"), std::invalid_argument);
+}
+
+void test_small_layout() {
+    ddaof::affix_compact_map<std::string, 3, 5, 2> map("pre", "su");
+    for (int i = 0; i < 100; ++i) {
+        std::string middle = std::to_string(10000 + i);
+        map["pre" + middle + "su"] = middle;
+    }
+    for (int i = 0; i < 100; ++i) {
+        std::string middle = std::to_string(10000 + i);
+        CHECK(map.at("pre" + middle + "su") == middle);
+        CHECK(map.count("prx" + middle + "su") == 0);
+    }
+}
+
+int main() {
+    test_only_the_middle_is_stored();
+    test_insert_find_erase();
+    test_foreign_keys();
+    test_small_layout();
+    return ddaof_test::check_report("affix_compact_map_test");
+}
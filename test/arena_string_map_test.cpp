@@ -0,0 +1,115 @@
+// Behavioral tests for arena_string_map.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/flat_hash_map arena_string_map_test.cpp
+//     ./a.out
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "arena_string_map.hpp"
+#include "check.hpp"
+
+std::string key_for(int i) {
+    return "key number " + std::to_string(i) + " with enough bytes to matter";
+}
+
+void test_insert_find_erase() {
+    ddaof::arena_string_map<int> map;
+    CHECK(map.emplace("one", 1).second);
+    CHECK(!map.emplace("one", 2).second);
+    map["two"] = 2;
+    map[""] = 0;
+    CHECK(map.size() == 3);
+    CHECK(map.at("one") == 1);
+    CHECK(map.at("") == 0);
+    CHECK(map.key(*map.find("two")) == "two");
+    CHECK(map.count("three") == 0);
+    CHECK(map.erase("one") == 1);
+    CHECK(map.erase("one") == 0);
+    CHECK(map.find("one") == map.end());
+    CHECK(map.dead_key_bytes() == 3);
+    CHECK_THROWS(map.at("one"), std::out_of_range);
+    map.insert_or_assign("two", 22);
+    CHECK(map.at("two") == 22);
+}
+
+void test_existing_keys_leave_the_arena_alone() {
+    ddaof::arena_string_map<int> map;
+    for (int i = 0; i < 100; ++i) {
+        map[key_for(i)] = i;
+    }
+    // a compacted arena has no spare capacity, so a single appended byte would move it
+    map.compact();
+    std::string_view first_key = map.key(*map.find(key_for(0)));
+    size_t arena_bytes = map.memory_usage();
+    for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 100; ++i) {
+            map[key_for(i)] += 1;
+            CHECK(!map.emplace(key_for(i), 0).second);
+        }
+    }
+    // no bytes were appended, so the views into the arena are still valid
+    CHECK(map.memory_usage() == arena_bytes);
+    CHECK(map.key(*map.find(key_for(0))).data() == first_key.data());
+    CHECK(first_key == key_for(0));
+    CHECK(map.at(key_for(7)) == 7 + 100);
+}
+
+void test_compaction() {
+    ddaof::arena_string_map<int> map;
+    for (int round = 0; round < 4; ++round) {
+        for (int i = 0; i < 2000; ++i) {
+            map[key_for(round * 2000 + i)] = i;
+        }
+        for (int i = 0; i < 2000; i += 2) {
+            CHECK(map.erase(key_for(round * 2000 + i)) == 1);
+        }
+    }
+    CHECK(map.size() == 4000);
+    map.compact();
+    CHECK(map.dead_key_bytes() == 0);
+    for (int round = 0; round < 4; ++round) {
+        for (int i = 1; i < 2000; i += 2) {
+            auto found = map.find(key_for(round * 2000 + i));
+            CHECK(found != map.end() && found->second == i && map.key(*found) == key_for(round * 2000 + i));
+        }
+    }
+    size_t visited = 0;
+    for (const auto& entry : map) {
+        CHECK(map.find(map.key(entry)) != map.end());
+        ++visited;
+    }
+    CHECK(visited == 4000);
+}
+
+void test_copy_and_move() {
+    ddaof::arena_string_map<int> map;
+    for (int i = 0; i < 500; ++i) {
+        map[key_for(i)] = i;
+    }
+    ddaof::arena_string_map<int> copy(map);
+    ddaof::arena_string_map<int> moved(std::move(copy));
+    CHECK(copy.empty());
+    ddaof::arena_string_map<int> assigned;
+    assigned["replaced"] = -1;
+    assigned = std::move(moved);
+    CHECK(moved.empty());
+    CHECK(assigned.size() == 500 && assigned.count("replaced") == 0);
+    for (int i = 0; i < 500; ++i) {
+        CHECK(assigned.at(key_for(i)) == i);
+        CHECK(map.at(key_for(i)) == i);
+    }
+    assigned.clear();
+    CHECK(assigned.empty() && assigned.find(key_for(0)) == assigned.end());
+    assigned["again"] = 1;
+    CHECK(assigned.at("again") == 1);
+}
+
+int main() {
+    test_insert_find_erase();
+    test_existing_keys_leave_the_arena_alone();
+    test_compaction();
+    test_copy_and_move();
+    return ddaof_test::check_report("arena_string_map_test");
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <iostream>
+
+// The tests are plain programs like the benchmarks next to them: a failed CHECK prints where it failed,
+// and main returns check_report(), which is non-zero after any failure.
+namespace ddaof_test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline int check_report(const char* name) {
+    std::cout << name << ": " << (failures() ? "FAILED" : "passed");
+    if (failures()) {
+        std::cout << " (" << failures() << " checks)";
+    }
+    std::cout << std::endl;
+    return failures() ? 1 : 0;
+}
+
+} // end namespace ddaof_test
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            ++ddaof_test::failures(); \
+        } \
+    } while (false)
+
+#define CHECK_THROWS(expression, exception_type) \
+    do { \
+        bool thrown = false; \
+        try { \
+            expression; \
+        } catch (const exception_type&) { \
+            thrown = true; \
+        } \
+        if (!thrown) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #expression " did not throw " #exception_type << std::endl; \
+            ++ddaof_test::failures(); \
+        } \
+    } while (false)
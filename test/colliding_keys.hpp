@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#include "faster_hashtable.hpp"
+
+namespace ddaof_test {
+
+// the key is its own hash, so keys that share their low bits share a bucket
+struct identity_hash {
+    typedef ddaof::power_of_two_hash_policy hash_policy;
+    typedef std::true_type is_avalanching;
+
+    size_t operator()(uint64_t key) const {
+        return static_cast<size_t>(key);
+    }
+};
+
+// keys that all want slot 5 of any power of two table smaller than 2^40 buckets
+inline uint64_t colliding_key(uint64_t i) {
+    return (i << 40) | 5;
+}
+
+} // end namespace ddaof_test
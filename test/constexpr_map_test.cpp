@@ -0,0 +1,74 @@
+// Behavioral tests for constexpr_map.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/flat_hash_map constexpr_map_test.cpp
+//     ./a.out
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "check.hpp"
+#include "constexpr_map.hpp"
+
+static constexpr std::pair<std::string_view, int> command_items[] = {
+    { "get", 1 }, { "set", 2 }, { "del", 3 }, { "incr", 4 }, { "decr", 5 }
+};
+static constexpr auto commands = ddaof::make_constexpr_map(command_items);
+
+// lookups that are answered at compile time
+static_assert(commands.size() == 5, "constexpr_map keeps every key");
+static_assert(*commands.find("get") == 1, "constexpr_map finds a key in a constant expression");
+static_assert(commands.at("decr") == 5, "constexpr_map::at works in a constant expression");
+static_assert(commands.find("put") == nullptr, "constexpr_map misses in a constant expression");
+static_assert(commands.count("del") == 1 && commands.count("") == 0, "constexpr_map::count");
+
+void test_runtime_lookups() {
+    for (const auto& item : command_items) {
+        std::string key(item.first); // a key that does not point into the map
+        const int* found = commands.find(key);
+        CHECK(found != nullptr);
+        CHECK(found && *found == item.second);
+    }
+    for (const char* missing : { "", "ge", "gets", "GET", "incr ", "xyz" }) {
+        CHECK(commands.find(missing) == nullptr);
+    }
+    CHECK_THROWS(commands.at("missing"), std::out_of_range);
+}
+
+constexpr size_t many = 300;
+
+struct many_items {
+    std::pair<uint64_t, uint64_t> items[many];
+
+    constexpr many_items() : items() {
+        for (size_t i = 0; i < many; ++i) {
+            items[i].first = i * 7919; // std::pair's assignment is not constexpr before C++20
+            items[i].second = i;
+        }
+    }
+};
+
+void test_every_key_gets_its_own_slot() {
+    static constexpr many_items source;
+    static constexpr ddaof::constexpr_map<uint64_t, uint64_t, many> map(source.items);
+    static_assert(map.bucket_count() >= 2 * many, "constexpr_map stays at most half full");
+    for (size_t i = 0; i < many; ++i) {
+        const uint64_t* found = map.find(i * 7919);
+        CHECK(found != nullptr);
+        CHECK(found && *found == i);
+        // the key that fills the empty slots must not make misses look like hits
+        CHECK(map.find(i * 7919 + 1) == nullptr);
+    }
+}
+
+void test_duplicate_keys_throw() {
+    const std::pair<std::string_view, int> duplicates[] = { { "a", 1 }, { "b", 2 }, { "a", 3 } };
+    CHECK_THROWS(ddaof::make_constexpr_map(duplicates), std::invalid_argument);
+}
+
+int main() {
+    test_runtime_lookups();
+    test_every_key_gets_its_own_slot();
+    test_duplicate_keys_throw();
+    return ddaof_test::check_report("constexpr_map_test");
+}
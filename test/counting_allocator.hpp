@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <stddef.h>
+
+namespace ddaof_test {
+
+// what every counting_allocator holds right now, whatever it was rebound to
+inline size_t g_live_bytes = 0;
+
+// lets a test compare the memory_usage() a table reports with what it really asked for
+template<typename T>
+struct counting_allocator {
+    typedef T value_type;
+
+    counting_allocator() = default;
+
+    template<typename U>
+    counting_allocator(const counting_allocator<U>&) {}
+
+    T* allocate(size_t n) {
+        g_live_bytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        g_live_bytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const counting_allocator<U>&) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const counting_allocator<U>&) const {
+        return false;
+    }
+};
+
+} // end namespace ddaof_test
@@ -0,0 +1,261 @@
+// Behavioral tests for faster_hashtable, flat_hash_map and flat_hash_set.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/flat_hash_map faster_hashtable_test.cpp
+//     ./a.out
+#include <memory>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+#include "colliding_keys.hpp"
+#include "faster_hashtable.hpp"
+
+void test_iterator_dereference() {
+    ddaof::flat_hash_map<int, int> map;
+    map.emplace(7, 49);
+    auto it = map.begin();
+    CHECK((*it).first == 7);
+    CHECK((*it).second == 49);
+    (*it).second = 50;
+    CHECK(map.at(7) == 50);
+
+    const ddaof::flat_hash_map<int, int>& const_map = map;
+    CHECK((*const_map.begin()).second == 50);
+}
+
+void test_range_insert() {
+    std::vector<std::pair<int, std::string>> values;
+    for (int i = 0; i < 100; ++i) {
+        values.emplace_back(i, std::to_string(i));
+    }
+    ddaof::flat_hash_map<int, std::string> map;
+    map.insert(values.begin(), values.end());
+    map.insert({ { 100, "100" }, { 0, "not inserted" } });
+    CHECK(map.size() == 101);
+    CHECK(map.at(0) == "0");
+    CHECK(map.at(100) == "100");
+
+    // the copy constructor inserts the other table's range
+    ddaof::flat_hash_map<int, std::string> copy(map);
+    CHECK(copy.size() == 101);
+    for (int i = 0; i <= 100; ++i) {
+        CHECK(copy.at(i) == std::to_string(i));
+    }
+}
+
+void test_move_construct_and_swap() {
+    ddaof::flat_hash_map<int, std::string> map;
+    for (int i = 0; i < 50; ++i) {
+        map.emplace(i, std::to_string(i));
+    }
+    ddaof::flat_hash_map<int, std::string> moved(std::move(map));
+    CHECK(moved.size() == 50);
+    CHECK(moved.at(49) == "49");
+    CHECK(map.empty());
+    CHECK(map.begin() == map.end());
+
+    // the moved-from table is still usable
+    map.emplace(1000, "1000");
+    CHECK(map.size() == 1 && map.at(1000) == "1000");
+}
+
+void test_move_assign() {
+    ddaof::flat_hash_map<int, std::string> source;
+    for (int i = 0; i < 50; ++i) {
+        source.emplace(i, std::to_string(i));
+    }
+    ddaof::flat_hash_map<int, std::string> target;
+    target.emplace(-1, "replaced");
+    target = std::move(source);
+    CHECK(target.size() == 50);
+    CHECK(target.find(-1) == target.end());
+    CHECK(target.at(25) == "25");
+    CHECK(source.size() <= 1);
+
+    target = std::move(target);
+    CHECK(target.size() == 50);
+}
+
+// hands out memory filled with 0xff, which reads as an empty slot (-1) everywhere it is not written
+template<typename T>
+struct poisoning_allocator : std::allocator<T> {
+    template<typename U>
+    struct rebind {
+        typedef poisoning_allocator<U> other;
+    };
+
+    poisoning_allocator() = default;
+
+    template<typename U>
+    poisoning_allocator(const poisoning_allocator<U>&) {}
+
+    T* allocate(size_t n) {
+        T* result = std::allocator<T>::allocate(n);
+        memset(static_cast<void*>(result), 0xff, n * sizeof(T));
+        return result;
+    }
+};
+
+void test_rehash_writes_end_item() {
+    typedef std::pair<int, int> value_type;
+    ddaof::flat_hash_map<int, int, std::hash<int>, std::equal_to<int>, poisoning_allocator<value_type>> map;
+    map.reserve(100);
+    // begin() and operator++ stop at the special end item, so it has to be marked after every rehash
+    CHECK(map.begin() == map.end());
+    for (int i = 0; i < 100; ++i) {
+        map.emplace(i, i);
+    }
+    size_t visited = 0;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        ++visited;
+    }
+    CHECK(visited == 100);
+}
+
+struct remembering_hash : std::hash<std::string> {
+    typedef std::true_type remember_last_hit;
+};
+
+typedef ddaof::flat_hash_map<std::string, int, remembering_hash> remembering_map;
+
+void test_last_hit_cache_forgets_erased_entries() {
+    remembering_map map;
+    map["a"] = 1;
+    map["b"] = 2;
+    CHECK(map.find("a")->second == 1);
+    CHECK(map.erase("a") == 1);
+    // the cached slot is empty now, or holds whatever the erase shifted into it
+    CHECK(map.find("a") == map.end());
+    CHECK(map.find("b")->second == 2);
+    CHECK(map.emplace("a", 3).second);
+    CHECK(map.at("a") == 3);
+
+    CHECK(map.find("b") != map.end());
+    map.erase(map.find("b"));
+    CHECK(map.count("b") == 0);
+    CHECK(map.emplace("b", 4).second);
+    CHECK(map.at("b") == 4);
+}
+
+void test_last_hit_cache_forgets_across_rehash() {
+    remembering_map map;
+    map["cached"] = 1;
+    CHECK(map.find("cached")->second == 1);
+    // every grow frees the slot array the cached pointer pointed into
+    for (int i = 0; i < 1000; ++i) {
+        map[std::to_string(i)] = i;
+    }
+    CHECK(map.find("cached")->second == 1);
+    map.rehash(map.bucket_count() * 2);
+    CHECK(map.find("cached")->second == 1);
+    CHECK(map.find("0")->second == 0);
+    CHECK(!map.emplace("cached", 5).second);
+    CHECK(map.at("cached") == 1);
+
+    remembering_map other;
+    other["cached"] = 2;
+    other.find("cached");
+    map.swap(other);
+    CHECK(map.at("cached") == 2 && other.at("cached") == 1);
+    map.clear();
+    CHECK(map.find("cached") == map.end());
+}
+
+using ddaof_test::colliding_key;
+using ddaof_test::identity_hash;
+
+typedef ddaof::flat_hash_map<uint64_t, std::string, identity_hash> colliding_map;
+
+// long enough that std::string keeps it on the heap, so a lost or doubly destroyed value shows up under ASan
+std::string value_of(uint64_t i) {
+    return "the value that belongs to the colliding key number " + std::to_string(i);
+}
+
+bool holds_colliding(colliding_map& map, uint64_t first, uint64_t last) {
+    for (uint64_t i = first; i < last; ++i) {
+        auto found = map.find(colliding_key(i));
+        if (found == map.end() || found->second != value_of(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_stashed_keys_behave_like_the_rest() {
+    colliding_map map;
+    map.reserve(60);
+    size_t bucket_count = map.bucket_count();
+    // a full probe chain plus two keys that overflow it into the stash
+    uint64_t num_keys = static_cast<uint64_t>(map.stats().max_lookups) + 2;
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        CHECK(map.emplace(colliding_key(i), value_of(i)).second);
+    }
+    CHECK(map.bucket_count() == bucket_count);
+    CHECK(map.stats().stashed == 2);
+    CHECK(map.size() == num_keys);
+    CHECK(holds_colliding(map, 0, num_keys));
+    CHECK(!map.emplace(colliding_key(num_keys - 1), "again").second);
+    CHECK(map.find(colliding_key(num_keys)) == map.end());
+
+    size_t visited = 0;
+    for (const auto& entry : map) {
+        CHECK(entry.second == value_of(entry.first >> 40));
+        ++visited;
+    }
+    CHECK(visited == num_keys);
+
+    // erasing a stashed key frees its stash slot for the next overflow
+    CHECK(map.erase(colliding_key(num_keys - 1)) == 1);
+    CHECK(map.stats().stashed == 1);
+    CHECK(map.find(colliding_key(num_keys - 1)) == map.end());
+    CHECK(map.emplace(colliding_key(num_keys - 1), value_of(num_keys - 1)).second);
+    CHECK(map.stats().stashed == 2);
+
+    // the backward shift after erasing from the chain stops in front of the stash
+    CHECK(map.erase(colliding_key(0)) == 1);
+    CHECK(map.find(colliding_key(0)) == map.end());
+    CHECK(holds_colliding(map, 1, num_keys));
+
+    colliding_map copy(map);
+    CHECK(copy.size() == num_keys - 1);
+    CHECK(holds_colliding(copy, 1, num_keys));
+
+    for (auto it = map.begin(); it != map.end(); ) {
+        it = map.erase(it);
+    }
+    CHECK(map.empty());
+    CHECK(map.stats().stashed == 0);
+    CHECK(map.begin() == map.end());
+}
+
+void test_full_stash_grows_the_table() {
+    colliding_map map;
+    map.reserve(60);
+    size_t bucket_count = map.bucket_count();
+    uint64_t num_keys = 3 * static_cast<uint64_t>(map.stats().max_lookups);
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        CHECK(map.emplace(colliding_key(i), value_of(i)).second);
+    }
+    CHECK(map.bucket_count() > bucket_count);
+    CHECK(map.size() == num_keys);
+    CHECK(holds_colliding(map, 0, num_keys));
+    // the rehash takes everything out of the stash and places it again
+    map.rehash(map.bucket_count() * 2);
+    CHECK(holds_colliding(map, 0, num_keys));
+}
+
+int main() {
+    test_iterator_dereference();
+    test_range_insert();
+    test_move_construct_and_swap();
+    test_move_assign();
+    test_rehash_writes_end_item();
+    test_last_hit_cache_forgets_erased_entries();
+    test_last_hit_cache_forgets_across_rehash();
+    test_stashed_keys_behave_like_the_rest();
+    test_full_stash_grows_the_table();
+    return ddaof_test::check_report("faster_hashtable_test");
+}
@@ -0,0 +1,69 @@
+// Tests for fixed64_hash: every kernel the CPU can run has to see every byte of the key.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/string_hash fixed64_hash_test.cpp
+//     ./a.out
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "fixed64_hash.hpp"
+
+typedef uint64_t (*kernel_function)(const char*);
+
+std::vector<kernel_function> runnable_kernels() {
+    std::vector<kernel_function> result = { &ddaof::fixed64_hash::hash_portable };
+#ifdef DDAOF_FIXED64_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("aes")) {
+        result.push_back(&ddaof::fixed64_hash::hash_aes);
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        result.push_back(&ddaof::fixed64_hash::hash_crc32c);
+    }
+#endif
+    return result;
+}
+
+void test_every_byte_counts() {
+    std::string key = "AAACPGC" + std::string(49, 'x') + "VVQTYPXX";
+    CHECK(key.size() == ddaof::fixed64_hash::key_length);
+    for (kernel_function kernel : runnable_kernels()) {
+        uint64_t original = kernel(key.data());
+        CHECK(kernel(key.data()) == original);
+        for (size_t byte = 0; byte < key.size(); ++byte) {
+            for (int bit = 0; bit < 8; ++bit) {
+                std::string flipped = key;
+                flipped[byte] = static_cast<char>(flipped[byte] ^ (1 << bit));
+                CHECK(kernel(flipped.data()) != original);
+            }
+        }
+    }
+}
+
+void test_selected_kernel() {
+    std::string name = ddaof::fixed64_hash::kernel_name();
+    CHECK(name == "aes" || name == "crc32c" || name == "portable");
+
+    std::string key(64, 'k');
+    ddaof::fixed64_hash hash;
+    CHECK(hash(key) == ddaof::fixed64_hash::hash(key.data()));
+    // longer keys hash by their first 64 bytes, like CityHash64(str, STR_STABLE_LENGTH)
+    CHECK(hash(key + "tail") == hash(key));
+}
+
+void test_short_keys() {
+    ddaof::fixed64_hash hash;
+    // zero padding alone would make these equal, the length keeps them apart
+    CHECK(hash(std::string("a")) != hash(std::string("a\0", 2)));
+    CHECK(hash(std::string()) != hash(std::string(1, '\0')));
+    CHECK(hash(std::string("abc")) != hash(std::string("abd")));
+    CHECK(hash(std::string(63, 'k')) != hash(std::string(64, 'k')));
+}
+
+int main() {
+    test_every_byte_counts();
+    test_selected_kernel();
+    test_short_keys();
+    return ddaof_test::check_report("fixed64_hash_test");
+}
@@ -0,0 +1,72 @@
+// Tests for fixed_string. The equality has SSE2, AVX2 and byte paths, so build it both ways:
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/string_hash -I ../src/flat_hash_map fixed_string_test.cpp
+//     g++ -std=c++17 -g -fsanitize=address,undefined -mavx2 -I ../src/string_hash -I ../src/flat_hash_map fixed_string_test.cpp
+//     ./a.out
+#include <stdexcept>
+#include <string>
+
+#include "check.hpp"
+#include "faster_hashtable.hpp"
+#include "fixed_string.hpp"
+
+// sizes below, at and above the 16 and 32 byte vector widths, and with a tail after the vectors
+template<size_t N>
+void check_difference_in_every_byte() {
+    std::string text;
+    for (size_t i = 0; i < N; ++i) {
+        text += static_cast<char>('a' + i % 26);
+    }
+    ddaof::fixed_string<N> key(text);
+    CHECK(key == ddaof::fixed_string<N>(text));
+    CHECK(!(key != ddaof::fixed_string<N>(text)));
+    CHECK(key.str() == text);
+    for (size_t byte = 0; byte < N; ++byte) {
+        std::string changed = text;
+        changed[byte] = '#';
+        ddaof::fixed_string<N> other(changed);
+        CHECK(key != other);
+        CHECK(std::hash<ddaof::fixed_string<N>>()(key) != std::hash<ddaof::fixed_string<N>>()(other));
+    }
+}
+
+void test_equality_sees_every_byte() {
+    check_difference_in_every_byte<1>();
+    check_difference_in_every_byte<15>();
+    check_difference_in_every_byte<16>();
+    check_difference_in_every_byte<17>();
+    check_difference_in_every_byte<31>();
+    check_difference_in_every_byte<32>();
+    check_difference_in_every_byte<33>();
+    check_difference_in_every_byte<49>();
+    check_difference_in_every_byte<64>();
+    check_difference_in_every_byte<100>();
+}
+
+void test_padding_and_length() {
+    ddaof::fixed_string<8> padded("abc", 3);
+    CHECK(padded.str() == std::string("abc\0\0\0\0\0", 8));
+    CHECK(padded == ddaof::fixed_string<8>(std::string("abc\0\0", 5)));
+    CHECK(ddaof::fixed_string<8>() == ddaof::fixed_string<8>(std::string()));
+    CHECK_THROWS(ddaof::fixed_string<8>(std::string("too long!")), std::length_error);
+    static_assert(sizeof(ddaof::fixed_string<49>) == 49, "no padding and no alignment");
+}
+
+void test_as_map_key() {
+    ddaof::flat_hash_map<ddaof::fixed_string<64>, int> map;
+    for (int i = 0; i < 1000; ++i) {
+        map[ddaof::fixed_string<64>(std::to_string(i))] = i;
+    }
+    for (int i = 0; i < 1000; ++i) {
+        auto found = map.find(ddaof::fixed_string<64>(std::to_string(i)));
+        CHECK(found != map.end() && found->second == i);
+    }
+    CHECK(map.count(ddaof::fixed_string<64>(std::string("1000"))) == 0);
+}
+
+int main() {
+    test_equality_sees_every_byte();
+    test_padding_and_length();
+    test_as_map_key();
+    return ddaof_test::check_report("fixed_string_test");
+}
@@ -4,6 +4,7 @@
 #include <functional>
 #include <chrono>
 #include "city.h"
+#include "fixed64_hash.hpp"
 
 // 生成随机字符串的函数
 std::string GenerateRandomString(size_t length) {
@@ -42,5 +43,15 @@ int main() {
     std::cout << "CityHash: " << diff_city.count() << " s\n";
     std::cout << "accelarate: " << (diff.count() - diff_city.count()) / diff.count() * 100 << "%" << std::endl;
 
+    // 测试fixed64_hash, 只处理64字节的key
+    start = std::chrono::high_resolution_clock::now();
+    for (const auto& s : test_strings) {
+        volatile auto hash = ddaof::fixed64_hash::hash(s.data());
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff_fixed = end - start;
+    std::cout << "fixed64_hash (" << ddaof::fixed64_hash::kernel_name() << "): " << diff_fixed.count() << " s\n";
+    std::cout << "accelarate over CityHash: " << (diff_city.count() - diff_fixed.count()) / diff_city.count() * 100 << "%" << std::endl;
+
     return 0;
 }
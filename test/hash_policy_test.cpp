@@ -0,0 +1,190 @@
+// Tests for the hash policies of faster_hashtable: every index a policy hands out has to be inside
+// the table, and a table using the policy has to keep working across its growth steps.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/flat_hash_map hash_policy_test.cpp
+//     ./a.out
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "check.hpp"
+#include "faster_hashtable.hpp"
+
+template<typename Policy>
+struct identity_hash {
+    typedef Policy hash_policy;
+
+    size_t operator()(uint64_t key) const {
+        return key;
+    }
+};
+
+// hashes with few bits set and hashes right at the edges, plus random ones
+std::vector<uint64_t> interesting_hashes() {
+    std::vector<uint64_t> result = { 0, 1, 2, 3, ~uint64_t(0), ~uint64_t(0) - 1, uint64_t(1) << 63 };
+    for (int bit = 0; bit < 64; ++bit) {
+        result.push_back(uint64_t(1) << bit);
+        result.push_back((uint64_t(1) << bit) - 1);
+    }
+    std::mt19937_64 rng(42);
+    for (int i = 0; i < 1000; ++i) {
+        result.push_back(rng());
+    }
+    return result;
+}
+
+// inserts, finds and erases with an identity hash, so small keys would pile up under a weak policy
+template<typename Policy>
+void check_table_with(uint64_t num_keys) {
+    ddaof::flat_hash_map<uint64_t, uint64_t, identity_hash<Policy>> map;
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        map.emplace(i, i * 2);
+    }
+    CHECK(map.size() == num_keys);
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        auto found = map.find(i);
+        CHECK(found != map.end() && found->second == i * 2);
+        CHECK(map.find(i + num_keys) == map.end());
+    }
+    for (uint64_t i = 0; i < num_keys; i += 2) {
+        CHECK(map.erase(i) == 1);
+    }
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        CHECK(map.count(i) == i % 2);
+    }
+    size_t visited = 0;
+    for (const auto& entry : map) {
+        CHECK(entry.first % 2 == 1);
+        ++visited;
+    }
+    CHECK(visited == map.size());
+}
+
+void test_fastrange_stays_in_range() {
+    ddaof::fastrange_hash_policy<> policy;
+    std::vector<uint64_t> hashes = interesting_hashes();
+    for (size_t num_slots : { size_t(2), size_t(3), size_t(7), size_t(100), size_t(1000003), size_t(3) << 40 }) {
+        size_t hits_in_slot_zero = 0;
+        for (uint64_t hash : hashes) {
+            size_t index = policy.index_for_hash(hash, num_slots - 1);
+            CHECK(index < num_slots);
+            hits_in_slot_zero += index == 0;
+        }
+        // the fibonacci pre-mix keeps small hashes from all mapping to the first slot
+        CHECK(num_slots < 4 || hits_in_slot_zero < hashes.size() / 2);
+        CHECK(policy.keep_in_range(num_slots, num_slots - 1) == 0);
+        CHECK(policy.keep_in_range(num_slots - 1, num_slots - 1) == num_slots - 1);
+    }
+}
+
+void test_fastrange_any_size_and_gentle_growth() {
+    ddaof::fastrange_hash_policy<> policy;
+    size_t size = 1000;
+    policy.next_size_over(size);
+    CHECK(size == 1000);
+    CHECK(policy.grow_size(1000) == 1500);
+    CHECK(policy.grow_size(1) == 4);
+
+    ddaof::fastrange_hash_policy<5, 4> slower;
+    CHECK(slower.grow_size(1000) == 1250);
+    CHECK(slower.grow_size(7) == 8);
+
+    ddaof::flat_hash_map<uint64_t, uint64_t, identity_hash<ddaof::fastrange_hash_policy<>>> map;
+    map.rehash(1000);
+    CHECK(map.bucket_count() == 1000);
+}
+
+void test_tables_with_fastrange() {
+    check_table_with<ddaof::fastrange_hash_policy<>>(10000);
+    check_table_with<ddaof::fastrange_hash_policy<5, 4>>(10000);
+}
+
+// walks the whole prime list through next_size_over, the way a growing table would
+void test_prime_remainder_matches_modulo() {
+    std::vector<uint64_t> hashes = interesting_hashes();
+    size_t num_primes = 0;
+    size_t prime = 0;
+    while (prime != 18446744073709551557ull) { // the last one, PrevPrime(2^64)
+        size_t request = prime + 1;
+        prime = request;
+        ddaof::prime_number_hash_policy policy;
+        policy.commit(policy.next_size_over(prime));
+        CHECK(prime >= request);
+        for (uint64_t hash : hashes) {
+            CHECK(policy.index_for_hash(hash, prime - 1) == hash % prime);
+        }
+        for (uint64_t hash : { uint64_t(prime), uint64_t(prime) - 1, uint64_t(prime) + 1, uint64_t(prime) * 2,
+                               ~uint64_t(0) / prime * prime, ~uint64_t(0) / prime * prime - 1 }) {
+            CHECK(policy.index_for_hash(hash, prime - 1) == hash % prime);
+        }
+        CHECK(policy.keep_in_range(prime, prime - 1) == 0);
+        CHECK(policy.keep_in_range(prime - 1, prime - 1) == prime - 1);
+        ++num_primes;
+    }
+    CHECK(num_primes > 100);
+}
+
+void test_prime_reset_state() {
+    ddaof::prime_number_hash_policy policy;
+    policy.reset();
+    for (uint64_t hash : interesting_hashes()) {
+        CHECK(policy.index_for_hash(hash, 0) < 2);
+    }
+}
+
+void test_tables_with_prime() {
+    check_table_with<ddaof::prime_number_hash_policy>(10000);
+    ddaof::flat_hash_map<uint64_t, uint64_t, identity_hash<ddaof::prime_number_hash_policy>> map;
+    map.rehash(1000);
+    CHECK(map.bucket_count() == 1009);
+}
+
+// libstdc++'s std::hash<uint64_t> is the identity, so it only gets good low bits from the pre-mix
+struct weak_power_of_two_hash : std::hash<uint64_t> {
+    typedef ddaof::power_of_two_hash_policy hash_policy;
+};
+
+struct avalanching_power_of_two_hash : std::hash<uint64_t> {
+    typedef ddaof::power_of_two_hash_policy hash_policy;
+    typedef std::true_type is_avalanching;
+};
+
+template<typename Hash>
+using selected_policy = typename ddaof::HashPolicySelector<Hash, uint64_t>::type;
+
+static_assert(std::is_same<selected_policy<weak_power_of_two_hash>,
+                           ddaof::premixed_hash_policy<ddaof::power_of_two_hash_policy>>::value,
+              "a weak hasher is pre-mixed before power-of-two indexing");
+static_assert(std::is_same<selected_policy<avalanching_power_of_two_hash>, ddaof::power_of_two_hash_policy>::value,
+              "a hasher that declares is_avalanching is trusted");
+static_assert(std::is_same<selected_policy<std::hash<uint64_t>>, ddaof::fibonacci_hash_policy>::value,
+              "fibonacci multiplies on its own, nothing to pre-mix");
+static_assert(std::is_same<selected_policy<identity_hash<ddaof::power_of_two_hash_policy>>,
+                           ddaof::power_of_two_hash_policy>::value,
+              "an unknown hasher is taken as it is");
+
+void test_weak_hash_keys_spread_after_premix() {
+    // the low 32 bits are all zero, the identity hash with a power-of-two mask puts them all in slot 0
+    ddaof::flat_hash_map<uint64_t, uint64_t, weak_power_of_two_hash> map;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        map.emplace(i << 32, i);
+    }
+    CHECK(map.bucket_count() <= 4096);
+    CHECK(map.stats().max_probe_length < map.stats().max_lookups);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        CHECK(map.count(i << 32) == 1);
+    }
+}
+
+int main() {
+    test_fastrange_stays_in_range();
+    test_fastrange_any_size_and_gentle_growth();
+    test_tables_with_fastrange();
+    test_prime_remainder_matches_modulo();
+    test_prime_reset_state();
+    test_tables_with_prime();
+    test_weak_hash_keys_spread_after_premix();
+    return ddaof_test::check_report("hash_policy_test");
+}
@@ -0,0 +1,73 @@
+// Tests for key_region. The window compare has SSE2, AVX2 and byte paths, so build it both ways:
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/string_hash -I ../src/flat_hash_map key_region_test.cpp
+//     g++ -std=c++17 -g -fsanitize=address,undefined -mavx2 -I ../src/string_hash -I ../src/flat_hash_map key_region_test.cpp
+//     ./a.out
+#include <string>
+
+#include "check.hpp"
+#include "faster_hashtable.hpp"
+#include "key_region.hpp"
+
+std::string structured_key(int i) {
+    std::string middle = std::to_string(i);
+    middle.resize(49, '-');
+    return "AAACPGC" + middle + "VVQTYPXX";
+}
+
+// a change inside the window is always seen, a change outside never is
+template<size_t Offset, size_t Length>
+void check_window() {
+    typedef ddaof::key_region<Offset, Length> region;
+    std::string key(Offset + Length + 5, 'k');
+    for (size_t byte = 0; byte < key.size(); ++byte) {
+        std::string changed = key;
+        changed[byte] = '#';
+        bool inside = byte >= Offset && byte < Offset + Length;
+        CHECK(typename region::equal()(key, changed) == !inside);
+        CHECK((typename region::hash()(key) == typename region::hash()(changed)) == !inside);
+    }
+}
+
+void test_window_compare() {
+    check_window<0, 1>();
+    check_window<3, 15>();
+    check_window<3, 16>();
+    check_window<3, 17>();
+    check_window<7, 32>();
+    check_window<7, 33>();
+    check_window<7, 49>();
+    check_window<0, 64>();
+}
+
+void test_short_and_different_length_keys() {
+    typedef ddaof::structured_key_region region;
+    // shorter than the window: hashed and compared whole
+    CHECK(region::equal()(std::string("abc"), std::string("abc")));
+    CHECK(!region::equal()(std::string("abc"), std::string("abd")));
+    CHECK(region::hash()(std::string("abc")) != region::hash()(std::string("abd")));
+    // the same window but another length never compares equal
+    std::string key = structured_key(1);
+    CHECK(!region::equal()(key, key + "x"));
+}
+
+void test_as_map_hasher() {
+    typedef ddaof::structured_key_region region;
+    ddaof::flat_hash_map<std::string, int, region::hash, region::equal> map;
+    for (int i = 0; i < 1000; ++i) {
+        map[structured_key(i)] = i;
+    }
+    for (int i = 0; i < 1000; ++i) {
+        auto found = map.find(structured_key(i));
+        CHECK(found != map.end() && found->second == i);
+    }
+    CHECK(map.count(structured_key(1000)) == 0);
+    CHECK(map.count("short") == 0);
+}
+
+int main() {
+    test_window_compare();
+    test_short_and_different_length_keys();
+    test_as_map_hasher();
+    return ddaof_test::check_report("key_region_test");
+}
@@ -0,0 +1,136 @@
+// Behavioral tests for linear_hashtable and linear_hash_map.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/flat_hash_map linear_hashtable_test.cpp
+//     ./a.out
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "check.hpp"
+#include "linear_hashtable.hpp"
+
+// small segments, so a few hundred keys already split
+typedef ddaof::linear_hash_map<int, std::string, std::hash<int>, std::equal_to<int>,
+                               std::allocator<std::pair<int, std::string>>, 8> small_segment_map;
+
+template<typename Map>
+size_t count_by_iteration(const Map& map) {
+    size_t result = 0;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        ++result;
+    }
+    return result;
+}
+
+void test_insert_find_erase() {
+    ddaof::linear_hash_map<int, int> map;
+    CHECK(map.emplace(1, 10).second);
+    CHECK(!map.emplace(1, 11).second);
+    map[2] = 20;
+    CHECK(map.size() == 2);
+    CHECK(map.at(1) == 10);
+    CHECK(map.count(2) == 1);
+    CHECK(map.find(3) == map.end());
+    CHECK(map.erase(1) == 1);
+    CHECK(map.erase(1) == 0);
+    CHECK(map.find(1) == map.end());
+    CHECK(map.at(2) == 20);
+    CHECK_THROWS(map.at(1), std::out_of_range);
+}
+
+void test_iterate_empty() {
+    // no segments at all yet
+    ddaof::linear_hash_map<int, int> map;
+    CHECK(map.segment_count() == 0);
+    CHECK(map.begin() == map.end());
+    CHECK(count_by_iteration(map) == 0);
+    CHECK(map.find(1) == map.end());
+
+    // segments, but every one of them empty
+    for (int i = 0; i < 1000; ++i) {
+        map.emplace(i, i);
+    }
+    map.clear();
+    CHECK(map.segment_count() > 1);
+    CHECK(map.begin() == map.end());
+    CHECK(count_by_iteration(map) == 0);
+}
+
+void test_split() {
+    small_segment_map map;
+    for (int i = 0; i < 1000; ++i) {
+        map.emplace(i, std::to_string(i));
+    }
+    CHECK(map.size() == 1000);
+    CHECK(map.segment_count() >= 1000 / 8);
+    CHECK(map.load_factor() <= map.max_load_factor());
+    CHECK(count_by_iteration(map) == 1000);
+    for (int i = 0; i < 1000; ++i) {
+        auto found = map.find(i);
+        CHECK(found != map.end() && found->second == std::to_string(i));
+    }
+
+    for (int i = 0; i < 1000; i += 2) {
+        CHECK(map.erase(i) == 1);
+    }
+    CHECK(map.size() == 500);
+    CHECK(count_by_iteration(map) == 500);
+    for (int i = 0; i < 1000; ++i) {
+        CHECK((map.find(i) != map.end()) == (i % 2 == 1));
+    }
+
+    small_segment_map copy(map);
+    CHECK(copy == map);
+    small_segment_map moved(std::move(copy));
+    CHECK(moved == map);
+    CHECK(copy.empty() && copy.begin() == copy.end());
+}
+
+void test_reserve_splits_ahead() {
+    small_segment_map map;
+    map.reserve(1000);
+    size_t segments = map.segment_count();
+    CHECK(segments * 8 * map.max_load_factor() >= 1000);
+    for (int i = 0; i < 100; ++i) {
+        map.emplace(i, std::to_string(i));
+    }
+    CHECK(count_by_iteration(map) == 100);
+}
+
+// every key hashes the same, so no split can ever separate them
+struct constant_hash {
+    size_t operator()(int) const {
+        return 42;
+    }
+};
+
+void test_shared_hash_throws() {
+    ddaof::linear_hash_map<int, int, constant_hash, std::equal_to<int>, std::allocator<std::pair<int, int>>, 8> map;
+    int inserted = 0;
+    bool thrown = false;
+    try {
+        for (; inserted < 1000; ++inserted) {
+            map.emplace(inserted, inserted);
+        }
+    } catch (const std::length_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(inserted < 1000);
+    // the directory stays bounded and the keys that made it in are all still there
+    CHECK(map.segment_count() < 64);
+    CHECK(map.size() == static_cast<size_t>(inserted));
+    CHECK(count_by_iteration(map) == map.size());
+    for (int i = 0; i < inserted; ++i) {
+        CHECK(map.at(i) == i);
+    }
+}
+
+int main() {
+    test_insert_find_erase();
+    test_iterate_empty();
+    test_split();
+    test_reserve_splits_ahead();
+    test_shared_hash_throws();
+    return ddaof_test::check_report("linear_hashtable_test");
+}
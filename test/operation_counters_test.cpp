@@ -0,0 +1,107 @@
+// Tests for faster_hashtable::counters(), built with the counters turned on.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/flat_hash_map operation_counters_test.cpp
+//     ./a.out
+#define DDAOF_OPERATION_COUNTERS
+
+#include <stdint.h>
+#include <vector>
+
+#include "check.hpp"
+#include "colliding_keys.hpp"
+#include "faster_hashtable.hpp"
+
+using ddaof::table_counter;
+using ddaof_test::colliding_key;
+using ddaof_test::identity_hash;
+
+typedef ddaof::flat_hash_map<uint64_t, int, identity_hash> colliding_map;
+
+void test_find_counts() {
+    ddaof::flat_hash_map<int, int> map;
+    for (int i = 0; i < 100; ++i) {
+        map.emplace(i, i);
+    }
+    ddaof::operation_counts before = map.counters();
+    for (int i = 0; i < 150; ++i) {
+        map.find(i);
+    }
+    ddaof::operation_counts after = map.counters();
+    CHECK(after[table_counter::find_hit] - before[table_counter::find_hit] == 100);
+    CHECK(after[table_counter::find_miss] - before[table_counter::find_miss] == 50);
+    CHECK(after[table_counter::probe_step] - before[table_counter::probe_step] >= 150);
+}
+
+void test_stashed_keys_count_as_hits() {
+    colliding_map map;
+    map.reserve(60);
+    size_t bucket_count = map.bucket_count();
+    // a full probe chain plus two keys that overflow it into the stash
+    uint64_t num_keys = static_cast<uint64_t>(map.stats().max_lookups) + 2;
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        map.emplace(colliding_key(i), static_cast<int>(i));
+    }
+    CHECK(map.bucket_count() == bucket_count);
+    CHECK(map.stats().stashed == 2);
+    CHECK(map.counters()[table_counter::stash_insert] == 2);
+
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        ddaof::operation_counts before = map.counters();
+        auto found = map.find(colliding_key(i));
+        ddaof::operation_counts after = map.counters();
+        CHECK(found != map.end() && found->second == static_cast<int>(i));
+        CHECK(after[table_counter::find_hit] - before[table_counter::find_hit] == 1);
+        CHECK(after[table_counter::find_miss] == before[table_counter::find_miss]);
+        // the full chain is walked before the stash is scanned up to the key
+        uint64_t expected_steps = i < num_keys - 2 ? i + 1 : num_keys - 2 + 1 + (i - (num_keys - 2) + 1);
+        CHECK(after[table_counter::probe_step] - before[table_counter::probe_step] == expected_steps);
+    }
+
+    ddaof::operation_counts before = map.counters();
+    CHECK(map.find(colliding_key(num_keys)) == map.end());
+    ddaof::operation_counts after = map.counters();
+    CHECK(after[table_counter::find_miss] - before[table_counter::find_miss] == 1);
+    CHECK(after[table_counter::find_hit] == before[table_counter::find_hit]);
+    // a miss scans the whole stash
+    CHECK(after[table_counter::probe_step] - before[table_counter::probe_step]
+          == num_keys - 2 + 1 + static_cast<uint64_t>(map.stats().max_lookups));
+}
+
+struct remembering_hash : std::hash<int> {
+    typedef std::true_type remember_last_hit;
+};
+
+// compares spent by one rehash of a table holding 0 .. 999
+template<typename Map>
+uint64_t compares_in_rehash() {
+    Map map;
+    for (int i = 0; i < 1000; ++i) {
+        map.emplace(i, i);
+    }
+    uint64_t before = map.counters()[table_counter::compare];
+    map.rehash(map.bucket_count() * 4);
+    return map.counters()[table_counter::compare] - before;
+}
+
+void test_rehash_bypasses_last_hit_cache() {
+    // the reinserted keys are all new, so the cache would only add a compare for every one of them
+    uint64_t plain = compares_in_rehash<ddaof::flat_hash_map<int, int>>();
+    uint64_t cached = compares_in_rehash<ddaof::flat_hash_map<int, int, remembering_hash>>();
+    CHECK(cached == plain);
+
+    ddaof::flat_hash_map<int, int, remembering_hash> map;
+    for (int i = 0; i < 1000; ++i) {
+        map.emplace(i, i);
+    }
+    map.find(7);
+    uint64_t before = map.counters()[table_counter::last_hit];
+    map.rehash(map.bucket_count() * 4);
+    CHECK(map.counters()[table_counter::last_hit] == before);
+}
+
+int main() {
+    test_find_counts();
+    test_stashed_keys_count_as_hits();
+    test_rehash_bypasses_last_hit_cache();
+    return ddaof_test::check_report("operation_counters_test");
+}
@@ -0,0 +1,187 @@
+// Tests for seeded_string_hash and for faster_hashtable rehashing with a new seed when
+// probe chains overflow at a low load factor.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/flat_hash_map -I ../src/string_hash reseed_test.cpp
+//     ./a.out
+#include <stdint.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "colliding_keys.hpp"
+#include "faster_hashtable.hpp"
+#include "seeded_string_hash.hpp"
+
+using ddaof_test::colliding_key;
+
+// collides on purpose until it is reseeded: the identity hash sends keys that share their
+// low bits to the same bucket, any seed after that mixes them apart
+struct collide_until_reseeded {
+    typedef ddaof::power_of_two_hash_policy hash_policy;
+    typedef std::true_type is_avalanching;
+
+    uint64_t seed = 0;
+
+    size_t operator()(uint64_t key) const {
+        return seed ? ddaof::fmix64(key ^ seed) : key;
+    }
+
+    void reseed() {
+        ++seed;
+    }
+};
+
+std::vector<ddaof::rehash_event> g_events;
+
+void record_event(const ddaof::rehash_event& event, void*) {
+    if (event.after) {
+        g_events.push_back(event);
+    }
+}
+
+void test_string_hash_depends_on_seed() {
+    ddaof::seeded_string_hash first(1), same(1), second(2);
+    std::set<size_t> hashes;
+    std::string key;
+    // every length branch: empty, 1-3, 4-16, 17-48 and the 48-byte loop
+    for (int length = 0; length <= 200; ++length) {
+        CHECK(first(key) == same(key));
+        CHECK(first(key) != second(key));
+        CHECK(first(key) == first(key.c_str()));
+        hashes.insert(first(key));
+        key += static_cast<char>('a' + length % 26);
+    }
+    CHECK(hashes.size() == 201);
+
+    // only the content counts, not where it lives
+    std::string copy = std::string("not the same buffer ") + "but the same content";
+    CHECK(first(copy) == first("not the same buffer but the same content"));
+
+    ddaof::seeded_string_hash hash(7);
+    size_t before = hash("key");
+    hash.reseed();
+    CHECK(hash.seed() != 7);
+    CHECK(hash("key") != before);
+    hash.reseed(7);
+    CHECK(hash("key") == before);
+    CHECK(ddaof::seeded_string_hash().seed() == ddaof::seeded_string_hash().seed());
+}
+
+void test_overflow_reseeds_instead_of_growing() {
+    ddaof::flat_hash_map<uint64_t, int, collide_until_reseeded> map;
+    map.reserve(60);
+    size_t bucket_count = map.bucket_count();
+    g_events.clear();
+    map.set_rehash_listener(record_event);
+
+    // more colliding keys than a probe chain and the stash can hold
+    uint64_t num_keys = 3 * static_cast<uint64_t>(map.stats().max_lookups);
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        CHECK(map.emplace(colliding_key(i), static_cast<int>(i)).second);
+    }
+    CHECK(map.hash_function().seed == 1);
+    CHECK(map.bucket_count() == bucket_count);
+    CHECK(g_events.size() == 1);
+    CHECK(!g_events.empty() && g_events[0].reason == ddaof::rehash_reason::reseed);
+    CHECK(!g_events.empty() && g_events[0].new_bucket_count == bucket_count);
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        auto found = map.find(colliding_key(i));
+        CHECK(found != map.end() && found->second == static_cast<int>(i));
+    }
+    CHECK(map.stats().stashed == 0);
+}
+
+// a hasher that stays bad after a reseed gets one reseed per bucket count, then the table grows
+struct collides_after_reseed_too : collide_until_reseeded {
+    size_t operator()(uint64_t key) const {
+        return key;
+    }
+};
+
+void test_reseed_is_tried_once_per_bucket_count() {
+    ddaof::flat_hash_map<uint64_t, int, collides_after_reseed_too> map;
+    map.reserve(60);
+    size_t bucket_count = map.bucket_count();
+    g_events.clear();
+    map.set_rehash_listener(record_event);
+
+    uint64_t num_keys = 3 * static_cast<uint64_t>(map.stats().max_lookups);
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        map.emplace(colliding_key(i), static_cast<int>(i));
+    }
+    CHECK(map.bucket_count() > bucket_count);
+    CHECK(map.size() == num_keys);
+    CHECK(!g_events.empty() && g_events[0].reason == ddaof::rehash_reason::reseed);
+    for (size_t i = 1; i < g_events.size(); ++i) {
+        // never two reseeds in a row at the same bucket count
+        bool repeated = g_events[i].reason == ddaof::rehash_reason::reseed
+                && g_events[i - 1].reason == ddaof::rehash_reason::reseed;
+        CHECK(!repeated);
+    }
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        CHECK(map.count(colliding_key(i)) == 1);
+    }
+}
+
+// stateful and never propagated, so move assignment between two of these has to move element by element
+template<typename T>
+struct tagged_allocator {
+    typedef T value_type;
+
+    int tag = 0;
+
+    tagged_allocator() = default;
+    explicit tagged_allocator(int tag) : tag(tag) {}
+
+    template<typename U>
+    tagged_allocator(const tagged_allocator<U>& other) : tag(other.tag) {}
+
+    T* allocate(size_t n) {
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const tagged_allocator<U>& other) const {
+        return tag == other.tag;
+    }
+
+    template<typename U>
+    bool operator!=(const tagged_allocator<U>& other) const {
+        return tag != other.tag;
+    }
+};
+
+void test_move_assignment_takes_the_seed_first() {
+    typedef tagged_allocator<std::pair<std::string, int>> allocator;
+    typedef ddaof::flat_hash_map<std::string, int, ddaof::seeded_string_hash, std::equal_to<std::string>, allocator> map_type;
+    map_type source(0, ddaof::seeded_string_hash(1), std::equal_to<std::string>(), allocator(1));
+    map_type target(0, ddaof::seeded_string_hash(2), std::equal_to<std::string>(), allocator(2));
+    for (int i = 0; i < 1000; ++i) {
+        source[std::to_string(i)] = i;
+    }
+    target["stale"] = -1;
+
+    target = std::move(source);
+    CHECK(target.get_allocator().tag == 2);
+    CHECK(target.hash_function().seed() == 1);
+    CHECK(target.size() == 1000);
+    CHECK(source.empty());
+    for (int i = 0; i < 1000; ++i) {
+        auto found = target.find(std::to_string(i));
+        CHECK(found != target.end() && found->second == i);
+    }
+    CHECK(target.count("stale") == 0);
+}
+
+int main() {
+    test_string_hash_depends_on_seed();
+    test_overflow_reseeds_instead_of_growing();
+    test_reseed_is_tried_once_per_bucket_count();
+    test_move_assignment_takes_the_seed_first();
+    return ddaof_test::check_report("reseed_test");
+}
@@ -0,0 +1,93 @@
+// Tests for what sherwood_v10_table reports about itself: stats() and memory_usage().
+// It shares names with faster_hashtable.hpp, so it gets its own program:
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/unordered_map sherwood_table_test.cpp
+//     ./a.out
+#include <cmath>
+#include <stdint.h>
+
+#include "check.hpp"
+#include "counting_allocator.hpp"
+#include "new_unoreder_map.hpp"
+
+size_t histogram_total(const ddaof::chain_stats& stats) {
+    size_t total = 0;
+    for (size_t count : stats.chain_length_histogram) {
+        total += count;
+    }
+    return total;
+}
+
+void test_stats_of_an_empty_table() {
+    // no buckets allocated yet, the table points at the shared empty_pointer() array
+    ddaof::unordered_map<int, int> map;
+    ddaof::chain_stats stats = map.stats();
+    CHECK(stats.buckets_scanned == map.bucket_count());
+    CHECK(stats.used_buckets == 0);
+    CHECK(stats.empty_buckets == stats.buckets_scanned);
+    CHECK(histogram_total(stats) == stats.buckets_scanned);
+    CHECK(stats.max_chain_length == 0);
+    CHECK(stats.mean_chain_length == 0);
+    CHECK(stats.load_factor == 0);
+    CHECK(map.stats(100).buckets_scanned == stats.buckets_scanned);
+}
+
+void test_stats_add_up() {
+    ddaof::unordered_map<int, int> map;
+    for (int i = 0; i < 1000; ++i) {
+        map.emplace(i, i);
+    }
+    ddaof::chain_stats stats = map.stats();
+    CHECK(stats.buckets_scanned == map.bucket_count());
+    CHECK(histogram_total(stats) == stats.buckets_scanned);
+    CHECK(stats.used_buckets + stats.empty_buckets == stats.buckets_scanned);
+    CHECK(stats.empty_buckets == stats.chain_length_histogram[0]);
+    CHECK(stats.max_chain_length + 1 == stats.chain_length_histogram.size());
+    CHECK(stats.load_factor == map.load_factor());
+
+    size_t elements = 0;
+    for (size_t length = 0; length < stats.chain_length_histogram.size(); ++length) {
+        elements += length * stats.chain_length_histogram[length];
+    }
+    CHECK(elements == map.size());
+    CHECK(std::abs(stats.mean_chain_length * stats.used_buckets - static_cast<double>(map.size())) < 1e-6);
+
+    // the sampled variant only follows as many chains as it is asked to
+    ddaof::chain_stats sampled = map.stats(100);
+    CHECK(sampled.buckets_scanned == 100);
+    CHECK(histogram_total(sampled) == 100);
+    CHECK(sampled.used_buckets + sampled.empty_buckets == 100);
+    CHECK(map.stats(1u << 30).buckets_scanned == stats.buckets_scanned);
+}
+
+void test_memory_usage_matches_the_allocator() {
+    using ddaof_test::g_live_bytes;
+    // both the nodes and the bucket array are allocated through rebinds of this
+    typedef ddaof_test::counting_allocator<std::pair<uint64_t, int>> allocator;
+    g_live_bytes = 0;
+    {
+        ddaof::unordered_map<uint64_t, int, std::hash<uint64_t>, std::equal_to<uint64_t>, allocator> map;
+        CHECK(map.memory_usage() == 0);
+        for (uint64_t i = 0; i < 1000; ++i) {
+            map.emplace(i, static_cast<int>(i));
+            CHECK(map.memory_usage() == g_live_bytes);
+        }
+        map.rehash(map.bucket_count() * 2);
+        CHECK(map.memory_usage() == g_live_bytes);
+        CHECK(map.deep_memory_usage() == map.memory_usage());
+        for (uint64_t i = 0; i < 500; ++i) {
+            map.erase(i);
+        }
+        CHECK(map.memory_usage() == g_live_bytes);
+        map.clear();
+        CHECK(map.memory_usage() == g_live_bytes);
+    }
+    CHECK(g_live_bytes == 0);
+}
+
+int main() {
+    test_stats_of_an_empty_table();
+    test_stats_add_up();
+    test_memory_usage_matches_the_allocator();
+    return ddaof_test::check_report("sherwood_table_test");
+}
@@ -0,0 +1,129 @@
+// Behavioral tests for small_flat_map.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/flat_hash_map small_flat_map_test.cpp
+//     ./a.out
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "check.hpp"
+#include "small_flat_map.hpp"
+#include "string_map_helpers.hpp"
+
+typedef ddaof::small_flat_map<std::string, std::string, 4> string_map;
+
+using ddaof_test::holds;
+using ddaof_test::long_string;
+using ddaof_test::make_map;
+
+void test_inline_insert_find_erase() {
+    ddaof::small_flat_map<int, int, 4> map;
+    CHECK(map.empty());
+    CHECK(map.is_inline());
+    CHECK(map.begin() == map.end());
+    CHECK(map.emplace(1, 10).second);
+    CHECK(!map.emplace(1, 11).second);
+    CHECK(map.at(1) == 10);
+    map[2] = 20;
+    map[3] = 30;
+    CHECK(map.size() == 3);
+    CHECK(map.count(2) == 1);
+    CHECK(map.memory_usage() == 0);
+
+    // erasing from the middle moves the last element into the hole
+    CHECK(map.erase(1) == 1);
+    CHECK(map.erase(1) == 0);
+    CHECK(map.find(1) == map.end());
+    CHECK(map.at(2) == 20);
+    CHECK(map.at(3) == 30);
+    CHECK_THROWS(map.at(1), std::out_of_range);
+    CHECK(map.is_inline());
+}
+
+void test_spill_keeps_elements() {
+    string_map map = make_map<string_map>(4);
+    CHECK(map.is_inline());
+    CHECK(holds(map, 4));
+
+    auto inserted = map.emplace(long_string(4), long_string(-4));
+    CHECK(inserted.second);
+    CHECK(inserted.first->first == long_string(4));
+    CHECK(!map.is_inline());
+    CHECK(map.memory_usage() > 0);
+    CHECK(holds(map, 5));
+
+    for (int i = 5; i < 100; ++i) {
+        map[long_string(i)] = long_string(-i);
+    }
+    CHECK(holds(map, 100));
+    CHECK(map.erase(long_string(50)) == 1);
+    CHECK(map.find(long_string(50)) == map.end());
+    CHECK(map.size() == 99);
+
+    // a spilled map stays spilled
+    map.clear();
+    CHECK(map.empty());
+    CHECK(!map.is_inline());
+    map[long_string(1)] = long_string(-1);
+    CHECK(map.size() == 1);
+    CHECK(map.at(long_string(1)) == long_string(-1));
+}
+
+void test_reserve_spills_early() {
+    string_map map = make_map<string_map>(2);
+    map.reserve(4);
+    CHECK(map.is_inline());
+    map.reserve(64);
+    CHECK(!map.is_inline());
+    CHECK(holds(map, 2));
+}
+
+void test_copy_and_move() {
+    for (int count : { 3, 40 }) {
+        string_map original = make_map<string_map>(count);
+
+        string_map copy(original);
+        CHECK(holds(copy, count));
+        CHECK(holds(original, count));
+        CHECK(copy == original);
+
+        string_map assigned = make_map<string_map>(count == 3 ? 40 : 3);
+        assigned = original;
+        CHECK(holds(assigned, count));
+        CHECK(assigned.is_inline() == original.is_inline());
+
+        string_map moved(std::move(copy));
+        CHECK(holds(moved, count));
+        CHECK(copy.empty());
+        CHECK(copy.is_inline());
+
+        // a moved-from map can be filled again, and spill again
+        copy = make_map<string_map>(10);
+        CHECK(holds(copy, 10));
+
+        string_map move_assigned = make_map<string_map>(count == 3 ? 40 : 3);
+        move_assigned = std::move(moved);
+        CHECK(holds(move_assigned, count));
+        CHECK(moved.empty());
+    }
+}
+
+void test_equality_ignores_storage() {
+    string_map inline_map = make_map<string_map>(3);
+    string_map spilled = make_map<string_map>(3);
+    spilled.reserve(64);
+    CHECK(inline_map.is_inline());
+    CHECK(!spilled.is_inline());
+    CHECK(inline_map == spilled);
+    spilled[long_string(1)] = "changed";
+    CHECK(inline_map != spilled);
+}
+
+int main() {
+    test_inline_insert_find_erase();
+    test_spill_keeps_elements();
+    test_reserve_spills_early();
+    test_copy_and_move();
+    test_equality_ignores_storage();
+    return ddaof_test::check_report("small_flat_map_test");
+}
@@ -0,0 +1,88 @@
+// Behavioral tests for static_flat_map.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/flat_hash_map static_flat_map_test.cpp
+//     ./a.out
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "check.hpp"
+#include "static_flat_map.hpp"
+#include "string_map_helpers.hpp"
+
+typedef ddaof::static_flat_map<std::string, std::string, 16> string_map;
+
+using ddaof_test::holds;
+using ddaof_test::long_string;
+using ddaof_test::make_map;
+
+void test_insert_find_erase() {
+    ddaof::static_flat_map<int, int, 8> map;
+    CHECK(map.empty());
+    CHECK(map.begin() == map.end());
+    CHECK(map.emplace(1, 10).second);
+    CHECK(!map.emplace(1, 11).second);
+    CHECK(map.at(1) == 10);
+    map[2] = 20;
+    CHECK(map.size() == 2);
+    CHECK(map.count(2) == 1);
+    CHECK(map.erase(1) == 1);
+    CHECK(map.erase(1) == 0);
+    CHECK(map.find(1) == map.end());
+    CHECK_THROWS(map.at(1), std::out_of_range);
+}
+
+void test_full_map_rejects_inserts() {
+    ddaof::static_flat_map<int, int, 8> map;
+    int inserted = 0;
+    for (int i = 0; i < 100; ++i) {
+        inserted += map.emplace(i, i).second;
+    }
+    CHECK(inserted <= 8);
+    CHECK(map.size() == static_cast<size_t>(inserted));
+    auto rejected = map.emplace(1000, 0);
+    CHECK(!rejected.second && rejected.first == map.end());
+    CHECK_THROWS(map[1000], std::length_error);
+    for (int i = 0; i < 100; ++i) {
+        auto found = map.find(i);
+        CHECK(found == map.end() || found->second == i);
+    }
+}
+
+void test_copy() {
+    string_map map = make_map<string_map>(10);
+    string_map copy(map);
+    CHECK(holds(copy, 10));
+    CHECK(holds(map, 10));
+
+    string_map assigned = make_map<string_map>(3);
+    assigned = map;
+    CHECK(holds(assigned, 10));
+    assigned = assigned;
+    CHECK(holds(assigned, 10));
+}
+
+void test_move() {
+    string_map map = make_map<string_map>(10);
+    string_map moved(std::move(map));
+    CHECK(holds(moved, 10));
+    CHECK(map.empty());
+    CHECK(map.begin() == map.end());
+
+    string_map assigned = make_map<string_map>(3);
+    assigned = std::move(moved);
+    CHECK(holds(assigned, 10));
+    CHECK(moved.empty());
+
+    // moved-from maps take new keys
+    moved[long_string(1)] = long_string(-1);
+    CHECK(moved.size() == 1 && moved.at(long_string(1)) == long_string(-1));
+}
+
+int main() {
+    test_insert_find_erase();
+    test_full_map_rejects_inserts();
+    test_copy();
+    test_move();
+    return ddaof_test::check_report("static_flat_map_test");
+}
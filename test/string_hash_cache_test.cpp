@@ -0,0 +1,94 @@
+// Behavioral tests for string_hash_cache. Needs CityHash's city.h on the include path:
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/string_hash -I <cityhash>/src string_hash_cache_test.cpp <cityhash>/src/city.cc
+//     ./a.out
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "string_hash_cache.hpp"
+
+uint64_t expected_hash(const std::string& key) {
+    return CityHash64(key.data(), std::min(key.size(), ddaof::STR_STABLE_LENGTH));
+}
+
+void test_hits_return_the_city_hash() {
+    ddaof::string_hash_cache cache;
+    std::vector<std::string> keys;
+    std::string key;
+    // empty, shorter than a word, one to two words, the sampled-words path and longer than the stable length
+    for (int length = 0; length <= 100; ++length) {
+        keys.push_back(key);
+        key += static_cast<char>('a' + length % 26);
+    }
+    for (const std::string& each : keys) {
+        CHECK(cache.get_hash(each) == expected_hash(each));
+    }
+    uint64_t misses = cache.misses();
+    CHECK(cache.hits() + misses == keys.size());
+    for (const std::string& each : keys) {
+        CHECK(cache.get_hash(each) == expected_hash(each));
+    }
+    CHECK(cache.misses() == misses);
+    CHECK(cache.hits() + cache.misses() == 2 * keys.size());
+}
+
+void test_only_the_stable_prefix_counts() {
+    ddaof::string_hash_cache cache;
+    std::string prefix(ddaof::STR_STABLE_LENGTH, 'p');
+    CHECK(cache.get_hash(prefix + "first tail") == expected_hash(prefix));
+    CHECK(cache.get_hash(prefix + "second tail") == expected_hash(prefix));
+    CHECK(cache.hits() == 1);
+    CHECK(cache.get_hash(prefix.data(), prefix.size()) == expected_hash(prefix));
+    CHECK(cache.hits() == 2);
+}
+
+void test_bytes_the_pre_hash_skips_still_count() {
+    ddaof::string_hash_cache cache;
+    // these only differ in a byte that none of the three sampled words cover,
+    // so they share set and tag and only the stored bytes tell them apart
+    std::string first(64, 'x');
+    std::string second = first;
+    second[1] = 'y';
+    CHECK(cache.get_hash(first) == expected_hash(first));
+    CHECK(cache.get_hash(second) == expected_hash(second));
+    CHECK(expected_hash(first) != expected_hash(second));
+    CHECK(cache.misses() == 2);
+
+    // same bytes, different length
+    std::string shorter = first.substr(0, 63);
+    CHECK(cache.get_hash(shorter) == expected_hash(shorter));
+    CHECK(cache.misses() == 3);
+}
+
+void test_eviction_and_clear() {
+    ddaof::string_hash_cache cache(1);
+    CHECK(cache.num_sets() == 1);
+    CHECK(ddaof::string_hash_cache(1000).num_sets() == 1024);
+
+    // one more key than the set has ways pushes out the oldest one
+    std::vector<std::string> keys;
+    for (size_t i = 0; i <= ddaof::string_hash_cache::ways; ++i) {
+        keys.push_back("key number " + std::to_string(i) + " of the eviction test");
+        CHECK(cache.get_hash(keys.back()) == expected_hash(keys.back()));
+    }
+    CHECK(cache.misses() == keys.size());
+    CHECK(cache.get_hash(keys.back()) == expected_hash(keys.back()));
+    CHECK(cache.hits() == 1);
+    CHECK(cache.get_hash(keys.front()) == expected_hash(keys.front()));
+    CHECK(cache.misses() == keys.size() + 1);
+
+    cache.clear();
+    CHECK(cache.hits() == 0 && cache.misses() == 0);
+    CHECK(cache.get_hash(keys.back()) == expected_hash(keys.back()));
+    CHECK(cache.misses() == 1);
+}
+
+int main() {
+    test_hits_return_the_city_hash();
+    test_only_the_stable_prefix_counts();
+    test_bytes_the_pre_hash_skips_still_count();
+    test_eviction_and_clear();
+    return ddaof_test::check_report("string_hash_cache_test");
+}
@@ -0,0 +1,128 @@
+// Behavioral tests for string_interner.
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -pthread -I ../src/string_hash string_interner_test.cpp
+//     ./a.out
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "string_interner.hpp"
+
+void test_dense_ids() {
+    ddaof::string_interner interner;
+    CHECK(interner.intern("alpha") == 0);
+    CHECK(interner.intern("beta") == 1);
+    CHECK(interner.intern("alpha") == 0);
+    CHECK(interner.intern("") == 2);
+    CHECK(interner.size() == 3);
+    CHECK(interner.find("beta") == 1);
+    CHECK(interner.find("gamma") == ddaof::string_interner::npos);
+    CHECK(interner.view(0) == "alpha");
+    CHECK(interner.view(2).empty());
+}
+
+void test_views_stay_valid() {
+    ddaof::string_interner interner;
+    std::vector<std::string_view> views;
+    // enough IDs for several directory chunks, and strings long enough to fill several arena blocks
+    for (uint32_t i = 0; i < 20000; ++i) {
+        std::string str = std::to_string(i) + std::string(i % 100, 'x');
+        CHECK(interner.intern(str) == i);
+        views.push_back(interner.view(i));
+    }
+    std::string oversized(100000, 'y');
+    uint32_t oversized_id = interner.intern(oversized);
+    for (uint32_t i = 0; i < 20000; ++i) {
+        CHECK(views[i].data() == interner.view(i).data());
+        CHECK(views[i] == std::to_string(i) + std::string(i % 100, 'x'));
+    }
+    CHECK(interner.view(oversized_id) == oversized);
+    CHECK(interner.memory_usage() > oversized.size());
+}
+
+void test_concurrent_interning() {
+    ddaof::string_interner interner;
+    const int num_threads = 4;
+    const uint32_t num_strings = 5000;
+    std::vector<std::vector<uint32_t>> ids(num_threads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            // every thread interns the same strings in another order
+            for (uint32_t i = 0; i < num_strings; ++i) {
+                uint32_t index = (i * 7919u + static_cast<uint32_t>(t) * 131u) % num_strings;
+                ids[t].push_back(interner.intern("string " + std::to_string(index)));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK(interner.size() == num_strings);
+    for (uint32_t index = 0; index < num_strings; ++index) {
+        uint32_t id = interner.find("string " + std::to_string(index));
+        CHECK(id < num_strings);
+        CHECK(interner.view(id) == "string " + std::to_string(index));
+    }
+}
+
+void test_exhaustion() {
+    ddaof::string_interner interner(3);
+    CHECK(interner.intern("a") == 0);
+    CHECK(interner.intern("b") == 1);
+    CHECK(interner.intern("c") == 2);
+    CHECK_THROWS(interner.intern("d"), std::length_error);
+    CHECK_THROWS(interner.intern("e"), std::length_error);
+    // known strings are still found, and the failed ones were not added
+    CHECK(interner.intern("b") == 1);
+    CHECK(interner.size() == 3);
+    CHECK(interner.find("d") == ddaof::string_interner::npos);
+}
+
+void test_concurrent_exhaustion() {
+    const uint32_t max_size = 1000;
+    ddaof::string_interner interner(max_size);
+    std::atomic<int> failures{ 0 };
+    std::vector<std::vector<uint32_t>> ids(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 500; ++i) {
+                try {
+                    ids[t].push_back(interner.intern(std::to_string(t) + "/" + std::to_string(i)));
+                } catch (const std::length_error&) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::vector<uint32_t> all_ids;
+    for (const std::vector<uint32_t>& thread_ids : ids) {
+        all_ids.insert(all_ids.end(), thread_ids.begin(), thread_ids.end());
+    }
+    std::sort(all_ids.begin(), all_ids.end());
+    // exactly max_size strings got IDs, all of them distinct and below the limit
+    CHECK(all_ids.size() == max_size);
+    CHECK(failures == 2000 - static_cast<int>(max_size));
+    CHECK(std::adjacent_find(all_ids.begin(), all_ids.end()) == all_ids.end());
+    CHECK(all_ids.empty() || all_ids.back() == max_size - 1);
+    CHECK(interner.size() == max_size);
+}
+
+int main() {
+    test_dense_ids();
+    test_views_stay_valid();
+    test_concurrent_interning();
+    test_exhaustion();
+    test_concurrent_exhaustion();
+    return ddaof_test::check_report("string_interner_test");
+}
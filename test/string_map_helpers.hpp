@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+namespace ddaof_test {
+
+// long enough that std::string keeps them on the heap
+inline std::string long_string(int i) {
+    return "a string that does not fit the small string buffer " + std::to_string(i);
+}
+
+// a map of count heap allocated keys and values, for the maps that take std::string both ways
+template<typename Map>
+Map make_map(int count) {
+    Map map;
+    for (int i = 0; i < count; ++i) {
+        map[long_string(i)] = long_string(-i);
+    }
+    return map;
+}
+
+// whether map holds exactly what make_map<Map>(count) put in, both through find() and iteration
+template<typename Map>
+bool holds(const Map& map, int count) {
+    if (map.size() != static_cast<size_t>(count)) {
+        return false;
+    }
+    size_t visited = 0;
+    for (const auto& entry : map) {
+        ++visited;
+        (void)entry;
+    }
+    for (int i = 0; i < count; ++i) {
+        auto found = map.find(long_string(i));
+        if (found == map.end() || found->second != long_string(-i)) {
+            return false;
+        }
+    }
+    return visited == static_cast<size_t>(count);
+}
+
+} // end namespace ddaof_test
@@ -0,0 +1,243 @@
+// Tests for what the containers report about themselves: stats(), the rehash listeners,
+// memory_usage() and dump_occupancy().
+//
+//     g++ -std=c++17 -g -fsanitize=address,undefined -I ../src/flat_hash_map table_diagnostics_test.cpp
+//     ./a.out
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "colliding_keys.hpp"
+#include "counting_allocator.hpp"
+#include "faster_hashtable.hpp"
+#include "linear_hashtable.hpp"
+#include "small_flat_map.hpp"
+#include "static_flat_map.hpp"
+#include "string_map_helpers.hpp"
+
+using ddaof_test::colliding_key;
+using ddaof_test::identity_hash;
+using ddaof_test::long_string;
+
+typedef ddaof::flat_hash_map<uint64_t, int, identity_hash> identity_map;
+
+size_t histogram_total(const ddaof::hashtable_stats& stats) {
+    size_t total = 0;
+    for (size_t count : stats.distance_histogram) {
+        total += count;
+    }
+    return total;
+}
+
+void test_stats_of_an_empty_table() {
+    identity_map map;
+    ddaof::hashtable_stats stats = map.stats();
+    CHECK(stats.full_slots == 0);
+    CHECK(stats.stashed == 0);
+    CHECK(stats.max_probe_length == 0);
+    CHECK(stats.longest_cluster == 0);
+    CHECK(stats.load_factor == 0);
+    CHECK(histogram_total(stats) == 0);
+}
+
+void test_stats_add_up() {
+    ddaof::flat_hash_map<int, int> map;
+    for (int i = 0; i < 1000; ++i) {
+        map.emplace(i, i);
+    }
+    ddaof::hashtable_stats stats = map.stats();
+    CHECK(stats.full_slots == 1000);
+    CHECK(histogram_total(stats) == 1000);
+    CHECK(stats.full_slots + stats.empty_slots == stats.slots_scanned);
+    CHECK(stats.slots_scanned >= map.bucket_count());
+    CHECK(stats.load_factor == map.load_factor());
+    CHECK(stats.max_probe_length < stats.max_lookups);
+
+    double distance_sum = 0;
+    for (size_t distance = 0; distance < stats.distance_histogram.size(); ++distance) {
+        distance_sum += static_cast<double>(distance * stats.distance_histogram[distance]);
+    }
+    CHECK(stats.mean_probe_length == distance_sum / 1000);
+
+    // the sampled variant only looks at as many slots as it is asked to
+    ddaof::hashtable_stats sampled = map.stats(100);
+    CHECK(sampled.slots_scanned == 100);
+    CHECK(sampled.full_slots + sampled.empty_slots == 100);
+    CHECK(map.stats(1u << 30).slots_scanned == stats.slots_scanned);
+}
+
+void test_stats_see_a_cluster() {
+    identity_map map;
+    map.reserve(60);
+    // keys that all want slot 5 sit at distances 0, 1, 2, ... in one run
+    uint64_t num_keys = static_cast<uint64_t>(map.stats().max_lookups) - 1;
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        map.emplace(colliding_key(i), static_cast<int>(i));
+    }
+    ddaof::hashtable_stats stats = map.stats();
+    CHECK(stats.longest_cluster == num_keys);
+    CHECK(stats.max_probe_length == static_cast<int8_t>(num_keys - 1));
+    for (uint64_t distance = 0; distance < num_keys; ++distance) {
+        CHECK(stats.distance_histogram[distance] == 1);
+    }
+}
+
+struct recorded_events {
+    std::vector<ddaof::rehash_event> events;
+};
+
+void record_event(const ddaof::rehash_event& event, void* context) {
+    static_cast<recorded_events*>(context)->events.push_back(event);
+}
+
+void test_rehash_listener_sees_every_rehash() {
+    identity_map map;
+    recorded_events recorded;
+    map.set_rehash_listener(record_event, &recorded);
+
+    map.reserve(100);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        map.emplace(i, static_cast<int>(i));
+    }
+    map.rehash(map.bucket_count() * 2);
+
+    const std::vector<ddaof::rehash_event>& events = recorded.events;
+    CHECK(events.size() >= 6);
+    CHECK(events.size() % 2 == 0);
+    // every rehash is reported twice, before the new buckets are allocated and after
+    for (size_t i = 0; i + 1 < events.size(); i += 2) {
+        CHECK(!events[i].after && events[i + 1].after);
+        CHECK(events[i].reason == events[i + 1].reason);
+        CHECK(events[i].new_bucket_count == events[i + 1].new_bucket_count);
+        CHECK(events[i].num_elements == events[i + 1].num_elements);
+        CHECK(events[i].elapsed_ns == 0);
+    }
+    CHECK(!events.empty() && events.front().reason == ddaof::rehash_reason::reserve);
+    CHECK(!events.empty() && events.front().old_bucket_count == 0);
+    CHECK(events.size() > 2 && events[2].reason == ddaof::rehash_reason::load_factor);
+    CHECK(!events.empty() && events.back().reason == ddaof::rehash_reason::explicit_rehash);
+    CHECK(!events.empty() && events.back().new_bucket_count == map.bucket_count());
+    CHECK(!events.empty() && events.back().num_elements == 1000);
+
+    // no listener, no events
+    size_t num_events = events.size();
+    map.set_rehash_listener(nullptr);
+    map.rehash(map.bucket_count() * 2);
+    CHECK(recorded.events.size() == num_events);
+}
+
+void test_table_listener_replaces_the_global_one() {
+    recorded_events global, own;
+    identity_map::set_global_rehash_listener(record_event, &global);
+    identity_map uses_global;
+    identity_map has_own;
+    has_own.set_rehash_listener(record_event, &own);
+    uses_global.reserve(100);
+    has_own.reserve(100);
+    identity_map::set_global_rehash_listener(nullptr);
+    identity_map after_reset;
+    after_reset.reserve(100);
+
+    CHECK(global.events.size() == 2);
+    CHECK(own.events.size() == 2);
+}
+
+void test_memory_usage_matches_the_allocator() {
+    using ddaof_test::g_live_bytes;
+    typedef ddaof_test::counting_allocator<std::pair<uint64_t, int>> allocator;
+    g_live_bytes = 0;
+    {
+        ddaof::flat_hash_map<uint64_t, int, std::hash<uint64_t>, std::equal_to<uint64_t>, allocator> map;
+        CHECK(map.memory_usage() == 0);
+        for (uint64_t i = 0; i < 1000; ++i) {
+            map.emplace(i, static_cast<int>(i));
+            CHECK(map.memory_usage() == g_live_bytes);
+        }
+        map.rehash(map.bucket_count() * 2);
+        CHECK(map.memory_usage() == g_live_bytes);
+        CHECK(map.deep_memory_usage() == map.memory_usage());
+    }
+    CHECK(g_live_bytes == 0);
+    {
+        ddaof::linear_hash_map<uint64_t, int, std::hash<uint64_t>, std::equal_to<uint64_t>, allocator, 64> map;
+        for (uint64_t i = 0; i < 1000; ++i) {
+            map.emplace(i, static_cast<int>(i));
+            CHECK(map.memory_usage() == g_live_bytes);
+        }
+    }
+    CHECK(g_live_bytes == 0);
+}
+
+void test_deep_memory_usage_counts_string_blocks() {
+    ddaof::flat_hash_map<int, std::string> map;
+    ddaof::small_flat_map<int, std::string, 4> small;
+    ddaof::static_flat_map<int, std::string, 16> fixed;
+    size_t string_bytes = 0;
+    for (int i = 0; i < 4; ++i) {
+        map[i] = long_string(i);
+        small[i] = long_string(i);
+        fixed[i] = long_string(i);
+        string_bytes += long_string(i).capacity() + 1;
+    }
+    // short strings live in the object itself
+    map[4] = "short";
+    CHECK(map.deep_memory_usage() == map.memory_usage() + string_bytes);
+    CHECK(small.is_inline() && small.memory_usage() == 0);
+    CHECK(small.deep_memory_usage() == string_bytes);
+    CHECK(fixed.memory_usage() == 0);
+    CHECK(fixed.deep_memory_usage() == string_bytes);
+}
+
+void test_occupancy_rows_add_up() {
+    identity_map map;
+    map.reserve(60);
+    uint64_t num_keys = static_cast<uint64_t>(map.stats().max_lookups) - 1;
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        map.emplace(colliding_key(i), static_cast<int>(i));
+    }
+    ddaof::hashtable_stats stats = map.stats();
+
+    std::ostringstream out;
+    map.dump_occupancy(out, 16);
+    std::istringstream in(out.str());
+    std::string line;
+    CHECK(std::getline(in, line) && line == "first_slot,slots,full,fill_ratio,max_distance,mean_distance");
+
+    size_t expected_first = 0, total_full = 0;
+    int max_distance = 0;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        size_t first = 0, slots = 0, full = 0;
+        double fill_ratio = 0, mean_distance = 0;
+        int distance = 0;
+        char comma = 0;
+        CHECK(fields >> first >> comma >> slots >> comma >> full >> comma >> fill_ratio >> comma
+                     >> distance >> comma >> mean_distance);
+        // regions tile the slots in order, only the last one can be short
+        CHECK(first == expected_first);
+        CHECK(slots > 0 && slots <= 16);
+        CHECK(full <= slots);
+        expected_first = first + slots;
+        total_full += full;
+        max_distance = std::max(max_distance, distance);
+    }
+    CHECK(expected_first == stats.slots_scanned);
+    CHECK(total_full == num_keys);
+    CHECK(max_distance == stats.max_probe_length);
+}
+
+int main() {
+    test_stats_of_an_empty_table();
+    test_stats_add_up();
+    test_stats_see_a_cluster();
+    test_rehash_listener_sees_every_rehash();
+    test_table_listener_replaces_the_global_one();
+    test_memory_usage_matches_the_allocator();
+    test_deep_memory_usage_counts_string_blocks();
+    test_occupancy_rows_add_up();
+    return ddaof_test::check_report("table_diagnostics_test");
+}